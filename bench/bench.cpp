@@ -0,0 +1,404 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+// Measure how fast we are and how much memory we need, on some generated
+// inputs. Each case runs in its own process, so the peak RSS is its own one.
+// The result is JSON, to compare the numbers of two versions by any tool you like
+//
+// The phases of a case are
+//   resolve  Font matching and page calculation, without font cache
+//   read     Read and decode all lines, nothing else
+//   layout   Expand tabs and wrap into rows, without the reading
+//   print    The whole conversion as done by wrt2pdf, including reading
+// With stdin there is only one chance to read, so read and layout are skipped
+
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <sys/resource.h>
+
+#include "converter.h"
+#include "pagesetup.h"
+#include "textlayout.h"
+#include "textsource.h"
+
+inline QTextStream& qStdErr()
+{
+    static QTextStream r{stderr};
+    return r;
+}
+
+struct Corpus
+{
+    enum Kind {
+        Tiny,
+        Ascii,
+        LongLines,
+        Utf8
+    };
+
+    QString name;
+    Kind    kind;
+    qint64  size;
+};
+
+static const QList<Corpus> corpora = {
+    {"tiny",       Corpus::Tiny,      0},
+    {"1mb",        Corpus::Ascii,     1 << 20},
+    {"100mb",      Corpus::Ascii,     100 << 20},
+    {"long-lines", Corpus::LongLines, 4 << 20},
+    {"utf8",       Corpus::Utf8,      4 << 20},
+};
+
+static double msSince(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1000000.0;
+}
+
+static QByteArray randomLine(QRandomGenerator &rng, Corpus::Kind kind)
+{
+    // Some of everything that hurts: other scripts, wide CJK, combining marks
+    static const QList<QByteArray> utf8Words = {
+        "Привет", "καλημέρα", "日本語のテキスト", "e\xCC\x81te\xCC\x81", "Straße", "naïve", "€uro", "中文", "word"
+    };
+
+    QByteArray line;
+    const int length = (kind == Corpus::LongLines) ? rng.bounded(5000, 50000) : rng.bounded(0, 110);
+
+    if (rng.bounded(10) == 0) line += '\t';
+    while (line.size() < length) {
+        if (kind == Corpus::Utf8 and rng.bounded(2)) {
+            line += utf8Words.at(rng.bounded(int(utf8Words.size())));
+        } else {
+            const int wordLength = rng.bounded(2, 10);
+            for (int i = 0; i < wordLength; ++i) line += char('a' + rng.bounded(26));
+        }
+        line += (rng.bounded(20) == 0) ? '\t' : ' ';
+    }
+    line += '\n';
+
+    return line;
+}
+
+// Always the same content for the same corpus, so runs are comparable
+static bool generate(const Corpus &corpus, const QString &fileName)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly)) return false;
+
+    if (corpus.kind == Corpus::Tiny) {
+        file.write("Hello World\n\tIndented by tab\n\nThat's all folks!\n");
+        return true;
+    }
+
+    QRandomGenerator rng(42);
+    QByteArray chunk;
+    qint64 written = 0;
+    while (written < corpus.size) {
+        chunk += randomLine(rng, corpus.kind);
+        if (chunk.size() > (1 << 20)) {
+            written += file.write(chunk);
+            chunk.clear();
+        }
+    }
+    file.write(chunk);
+
+    return file.error() == QFile::NoError;
+}
+
+// Child process, do one case and tell the result as JSON on stdout
+static int runCase(const QCommandLineParser &parser)
+{
+    const QString txtFile = parser.value("run-case");
+    const bool useStdin = parser.isSet("stdin");
+    QJsonObject phases;
+    QElapsedTimer timer;
+
+    PageSetup setup;
+    setup.fontFamily = parser.value("font");
+    setup.fontSize = 10;
+    setup.margins = QMarginsF(5.0, 5.0, 5.0, 5.0);
+    setup.backend = (parser.value("backend") == "native") ? PageSetup::NativeBackend : PageSetup::QtBackend;
+
+    timer.start();
+    setup.resolve();
+    phases["resolve"] = msSince(timer);
+
+    qint64 lines = 0;
+    qint64 rows = 0;
+    if (! useStdin) {
+        TextSource source;
+        QStringView line;
+
+        timer.start();
+        source.open(txtFile);
+        while (source.readLine(&line)) ++lines;
+        source.close();
+        const double readTime = msSince(timer);
+        phases["read"] = readTime;
+
+        QString tabBuffer;
+        timer.start();
+        source.open(txtFile);
+        while (source.readLine(&line)) {
+            line = TextLayout::expandTabs(line, tabBuffer);
+            TextLayout::wrapLine(line, setup.maxChar, [&rows](QStringView) { ++rows; });
+        }
+        source.close();
+        phases["layout"] = qMax(0.0, msSince(timer) - readTime);
+    }
+
+    const QString pdfFile = parser.value("output-dir") + "/" + QFileInfo(txtFile).completeBaseName() + ".pdf";
+    Converter converter(setup);
+    converter.setThreads(parser.value("jobs").toInt());
+    timer.start();
+    const bool success = converter.convert(ConvertJob{useStdin ? QString() : txtFile, pdfFile});
+    phases["print"] = msSince(timer);
+
+    if (! success) qStdErr() << converter.errorString() << Qt::endl;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    QJsonObject result;
+    result["success"] = success;
+    result["phases_ms"] = phases;
+    result["lines"] = lines;
+    result["rows"] = rows;
+    result["peak_rss_kb"] = qint64(usage.ru_maxrss);
+    result["output_bytes"] = QFileInfo(pdfFile).size();
+
+    QFile out;
+    out.open(stdout, QIODevice::WriteOnly);
+    out.write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+    out.write("\n");
+    QFile::remove(pdfFile);
+
+    return success ? 0 : 1;
+}
+
+// Feed the input by a pipe, not as file, to see how we do without mapping
+static QJsonObject spawnCase(const QStringList &arguments, const QString &stdinFile)
+{
+    QProcess process;
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    QElapsedTimer timer;
+    timer.start();
+    process.start(QCoreApplication::applicationFilePath(), arguments);
+    if (! process.waitForStarted(-1)) return QJsonObject{{"success", false}};
+
+    if (! stdinFile.isEmpty()) {
+        QFile in(stdinFile);
+        in.open(QIODevice::ReadOnly);
+        while (! in.atEnd()) {
+            process.write(in.read(1 << 20));
+            process.waitForBytesWritten(-1);
+        }
+    }
+    process.closeWriteChannel();
+    process.waitForFinished(-1);
+
+    QJsonObject result = QJsonDocument::fromJson(process.readAllStandardOutput()).object();
+    result["wall_ms"] = msSince(timer);
+    if (process.exitStatus() != QProcess::NormalExit) result["success"] = false;
+
+    return result;
+}
+
+// The start up targets of the README, on an ordinary desktop with warm file
+// cache. Slower is not an error, the machine may be slow, but we tell about it
+struct StartupTarget
+{
+    const char *name;
+    double      ms;
+};
+
+static const StartupTarget startupTargets[] = {
+    {"help_ms", 10.0},
+    {"list_mo_keys_ms", 10.0},
+    {"info_ms", 50.0},
+    {"one_line_stdin_ms", 50.0}
+};
+
+// The real thing, start to end, like the user see it
+static double timeCommand(const QString &program, const QStringList &arguments, int runs
+                        , const QString &inputFile = QProcess::nullDevice())
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < runs; ++i) {
+        QProcess process;
+        process.setStandardInputFile(inputFile);
+        process.setStandardOutputFile(QProcess::nullDevice());
+        process.start(program, arguments);
+        process.waitForFinished(-1);
+    }
+
+    return msSince(timer) / runs;
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("wrt2pdf-bench");
+
+    QCommandLineParser parser;
+    parser.addOption({{"o", "output"}, "Write the JSON result to <file> instead of stdout", "file"});
+    parser.addOption({"font", "Font family to use", "family", "Hack"});
+    parser.addOption({"font-file", "Use this font file, not installed fonts, to be independent of the system", "file"});
+    parser.addOption({"wrt2pdf", "Also time start up and a full run of this binary", "program"});
+    parser.addOption({{"j", "jobs"}, "Threads to use for a single file", "N", "1"});
+    parser.addOption({"quick", "Skip the 100mb corpus"});
+    // Internal, used for the child processes
+    parser.addOption({"run-case", "", "txt-file"});
+    parser.addOption({"backend", "", "name", "qt"});
+    parser.addOption({"stdin", ""});
+    parser.addOption({"output-dir", "", "dir"});
+    parser.addHelpOption();
+    parser.process(app);
+
+    QString font = parser.value("font");
+    if (parser.isSet("font-file")) {
+        const int id = QFontDatabase::addApplicationFont(parser.value("font-file"));
+        if (id < 0) {
+            qStdErr() << "Can't load font file: " << parser.value("font-file") << Qt::endl;
+            return 1;
+        }
+        font = QFontDatabase::applicationFontFamilies(id).value(0, font);
+    }
+
+    if (parser.isSet("run-case")) return runCase(parser);
+
+    QTemporaryDir dir;
+    if (! dir.isValid()) {
+        qStdErr() << "Can't create temp dir: " << dir.errorString() << Qt::endl;
+        return 1;
+    }
+
+    QJsonArray results;
+    bool allFine = true;
+
+    for (const Corpus &corpus : corpora) {
+        if (parser.isSet("quick") and corpus.size > (10 << 20)) continue;
+
+        const QString txtFile = dir.filePath(corpus.name + ".txt");
+        qStdErr() << "Generate " << corpus.name << Qt::endl;
+        if (! generate(corpus, txtFile)) {
+            qStdErr() << "Can't write " << txtFile << Qt::endl;
+            return 1;
+        }
+
+        for (const QString backend : {"qt", "native"}) {
+            for (const bool useStdin : {false, true}) {
+                const QString input = useStdin ? "stdin" : "file";
+                qStdErr() << "Run " << corpus.name << " " << backend << " " << input << Qt::endl;
+
+                QStringList arguments{"--run-case", txtFile, "--backend", backend, "--font", font
+                                    , "--output-dir", dir.path(), "--jobs", parser.value("jobs")};
+                if (parser.isSet("font-file")) arguments << "--font-file" << parser.value("font-file");
+                if (useStdin) arguments << "--stdin";
+
+                QJsonObject result = spawnCase(arguments, useStdin ? txtFile : QString());
+                result["corpus"] = corpus.name;
+                result["input_bytes"] = QFileInfo(txtFile).size();
+                result["backend"] = backend;
+                result["input"] = input;
+                allFine = allFine and result.value("success").toBool();
+                results << result;
+            }
+        }
+
+        // No need to keep 100MB around
+        QFile::remove(txtFile);
+    }
+
+    QJsonObject report;
+    report["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["qt_version"] = qVersion();
+    report["font"] = font;
+    report["jobs"] = parser.value("jobs").toInt();
+    report["results"] = results;
+
+    if (parser.isSet("wrt2pdf")) {
+        const QString program = parser.value("wrt2pdf");
+        QProcess version;
+        version.start(program, {"--version"});
+        version.waitForFinished(-1);
+        report["wrt2pdf_version"] = QString::fromLocal8Bit(version.readAllStandardOutput()).trimmed();
+
+        QJsonObject startup;
+        startup["help_ms"] = timeCommand(program, {"--help"}, 20);
+        startup["list_mo_keys_ms"] = timeCommand(program, {"--list-mo-keys", "A4"}, 20);
+        startup["info_ms"] = timeCommand(program, {"--info", "-f", font}, 20);
+        startup["info_no_font_cache_ms"] = timeCommand(program, {"--info", "-f", font, "--no-font-cache"}, 20);
+        const QString tinyFile = dir.filePath("startup.txt");
+        generate(corpora.first(), tinyFile);
+        startup["tiny_file_ms"] = timeCommand(program, {"-F", "-f", font, dir.filePath("startup.pdf"), tinyFile}, 20);
+        const QString lineFile = dir.filePath("line.txt");
+        QFile line(lineFile);
+        if (line.open(QIODevice::WriteOnly)) line.write("hello\n");
+        line.close();
+        startup["one_line_stdin_ms"] = timeCommand(program, {"-F", "-f", font, dir.filePath("line.pdf")}, 20, lineFile);
+        report["startup"] = startup;
+
+        QJsonObject targets;
+        for (const StartupTarget &target : startupTargets) {
+            const double ms = startup.value(target.name).toDouble();
+            QJsonObject check;
+            check["target_ms"] = target.ms;
+            check["met"] = ms <= target.ms;
+            targets[target.name] = check;
+            if (ms > target.ms) {
+                qStdErr() << "Start up target missed: " << target.name << " " << ms << " > " << target.ms << Qt::endl;
+            }
+        }
+        report["startup_targets"] = targets;
+    }
+
+    const QByteArray json = QJsonDocument(report).toJson();
+    if (parser.isSet("output")) {
+        QFile out(parser.value("output"));
+        if (! out.open(QIODevice::WriteOnly) or out.write(json) != json.size()) {
+            qStdErr() << "Can't write " << parser.value("output") << Qt::endl;
+            return 1;
+        }
+    } else {
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        out.write(json);
+    }
+
+    return allFine ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef WRT2PDF_H
+#define WRT2PDF_H
+
+#include <QByteArrayView>
+#include <QString>
+
+#include <functional>
+#include <memory>
+
+class QIODevice;
+
+// The way to use wrt2pdf in your own program, without to start one. Set it up
+// as the command line options do and convert as many texts as you like, the
+// font is resolved only once. A QGuiApplication must exist, we need its fonts.
+// Like Converter it's not thread safe, but each thread may have its own
+//
+//   Wrt2Pdf wrt2pdf;
+//   wrt2pdf.setFont("Hack,9");
+//   QFile pdf("foo.pdf");
+//   pdf.open(QIODevice::WriteOnly);
+//   if (! wrt2pdf.convert(text, &pdf)) qWarning() << wrt2pdf.errorString();
+class Wrt2Pdf
+{
+public:
+    // Fill data with up to maxSize bytes and return how many, 0 at the end
+    // and -1 on error. Like read(), a short return is fine
+    using PullFunc = std::function<qint64(char *data, qint64 maxSize)>;
+
+    Wrt2Pdf();
+    ~Wrt2Pdf();
+
+    // Same as --font, --page-size, --landscape, --margins, --backend,
+    // --compression and --object-streams. On a bad value is false returned
+    // and nothing changed
+    bool setFont(const QString &desc);
+    bool setPageSize(const QString &key);
+    void setLandscape(bool landscape);
+    bool setMargins(const QString &list);
+    bool setBackend(const QString &name);
+    bool setCompression(int level);
+    void setObjectStreams(bool enable);
+    // Threads to render the pages of one text, 0 is one for each core
+    void setThreads(int threads);
+
+    // Find the font and calculate maxChar and maxLines. The first convert()
+    // does it anyway, but you may like to know them in advance. False when
+    // the page has no room for text or the backend can't use the font
+    bool resolve();
+    // Columns and rows of a page, 0 until resolve()
+    int maxChar() const;
+    int maxLines() const;
+
+    // The PDF is written to sink, which must be open for writing. We never
+    // seek, so it can be a socket or pipe too. Title is shown by PDF viewers
+    // All text at once, it's only read and not copied
+    bool convert(QByteArrayView text, QIODevice *sink, const QString &title = QString());
+    // The text is asked from pull piece by piece
+    bool convert(const PullFunc &pull, QIODevice *sink, const QString &title = QString());
+    // A text file to a PDF file, as the command line does
+    bool convert(const QString &txtFile, const QString &pdfFile);
+
+    QString errorString() const;
+
+private:
+    // All the rest is ours, so no internal class is seen by your program
+    struct Private;
+    std::unique_ptr<Private> d;
+};
+
+#endif
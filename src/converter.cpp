@@ -0,0 +1,662 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "converter.h"
+#include "pagesetup.h"
+#include "paginator.h"
+#include "pdfrenderer.h"
+#include "resultcache.h"
+#include "stats.h"
+#include "textlayout.h"
+#include "textrenderer.h"
+
+#include <QAtomicInteger>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QPdfWriter>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QThreadPool>
+
+#include <memory>
+#include <vector>
+
+// Bump when the state file change
+static const int UpdateStateVersion = 1;
+
+// Anything which change the look of the pages, when it differs we start over
+static QString layoutKey(const PageSetup &setup)
+{
+    const QMarginsF &m = setup.margins;
+    return QString("%1|%2|%3|%4|%5|%6|%7,%8,%9,%10")
+           .arg(setup.font.toString()).arg(setup.maxChar).arg(setup.maxLines).arg(setup.resolution)
+           .arg(setup.pageSize.key()).arg(int(setup.pageOrientation))
+           .arg(m.left()).arg(m.top()).arg(m.right()).arg(m.bottom());
+}
+
+// To notice when the text of the last page was changed, not only appended. The
+// text before is not hashed, that would cost a read of the whole file each time
+static QByteArray tailHash(const QString &txtFile, qint64 from, qint64 to)
+{
+    QFile file(txtFile);
+    if (! file.open(QIODevice::ReadOnly) or ! file.seek(from)) return QByteArray();
+
+    return QCryptographicHash::hash(file.read(to - from), QCryptographicHash::Md5).toHex();
+}
+
+QString volumeName(const QString &pdfFile, int volume)
+{
+    const qsizetype dot = pdfFile.endsWith(".pdf") ? pdfFile.size() - 4 : pdfFile.size();
+    return pdfFile.left(dot) + QString("-%1.pdf").arg(volume, 3, 10, QChar('0'));
+}
+
+// The volumes of pdfFile on disk with a higher number than volume, left by an
+// earlier run or just made by us
+static QStringList volumesAfter(const QString &pdfFile, int volume)
+{
+    const QFileInfo first(volumeName(pdfFile, 1));
+    const QString base = first.fileName().chopped(8);    // Without "-001.pdf"
+    const QRegularExpression pattern("^" + QRegularExpression::escape(base) + "-(\\d{3,})\\.pdf$");
+
+    QStringList volumes;
+    const QDir dir = first.absoluteDir();
+    const QStringList names = dir.entryList({base + "-*.pdf"}, QDir::Files);
+    for (const QString &name : names) {
+        const QRegularExpressionMatch match = pattern.match(name);
+        if (match.hasMatch() and match.captured(1).toInt() > volume) volumes << dir.filePath(name);
+    }
+
+    return volumes;
+}
+
+// Volumes of a longer text before would be mixed up with the new ones
+static void removeVolumesAfter(const QString &pdfFile, int volume)
+{
+    for (const QString &stale : volumesAfter(pdfFile, volume)) QFile::remove(stale);
+}
+
+Converter::Converter(const PageSetup &setup)
+    : m_setup(setup)
+    , m_font(independentFont(setup.font.toString(), setup.resolution))
+{
+}
+
+void Converter::setResultCache(ResultCache *cache)
+{
+    m_resultCache = cache;
+    if (cache) m_resultKey = ResultCache::setupKey(m_setup);
+}
+
+bool Converter::convert(const ConvertJob &job)
+{
+    m_warningString.clear();
+    if (job.update) return update(job);
+
+    // Only a text file to a PDF file of its own is worth it, an update or
+    // volumes have their own rules
+    QByteArray resultHash;
+    if (m_resultCache and ! job.txtFile.isEmpty() and job.pdfFile != "-" and ! job.output
+        and job.volumePages == 0 and job.volumeBytes == 0) {
+        // The name is the /Title, a copy made for another file would show the wrong one
+        const QString docName = job.title.isEmpty() ? QFileInfo(job.txtFile).fileName() : job.title;
+        const QByteArray range = QByteArray::number(job.firstPage) + '-' + QByteArray::number(job.lastPage);
+        resultHash = ResultCache::hash(job.txtFile, m_resultKey + range + '|' + docName.toUtf8());
+        if (! resultHash.isEmpty() and m_resultCache->fetch(resultHash, job.pdfFile, job.overwrite)) return true;
+    }
+
+    // Checked not before, the PDF the cache noted may be replaced. Volumes
+    // never write pdfFile itself, but its numbered names
+    const bool hasVolumes = job.volumePages > 0 or job.volumeBytes > 0;
+    if (! job.overwrite and hasVolumes and ! volumesAfter(job.pdfFile, 0).isEmpty()) {
+        m_errorString = QString("Volumes already exist: %1\nUse --force if you don't care").arg(volumeName(job.pdfFile, 1));
+        return false;
+    }
+    if (! job.overwrite and ! hasVolumes and ! job.output and job.pdfFile != "-" and QFile::exists(job.pdfFile)) {
+        m_errorString = QString("File already exist: %1\nUse --force if you don't care").arg(job.pdfFile);
+        return false;
+    }
+
+    const bool success = convertText(job);
+    if (success and ! resultHash.isEmpty()) m_resultCache->store(resultHash, job.pdfFile);
+
+    return success;
+}
+
+bool Converter::convertText(const ConvertJob &job)
+{
+    QString docName = job.title;
+    if (job.txtFile.isEmpty() and job.input) {
+        m_source.openData(*job.input);
+    } else if (job.txtFile.isEmpty() and job.pull) {
+        m_source.openPull(job.pull);
+    } else if (job.txtFile.isEmpty()) {
+        m_source.openStdin();
+    } else if (! m_source.open(job.txtFile)) {
+        m_errorString = QString("Can't read %1: %2").arg(job.txtFile, m_source.errorString());
+        return false;
+    } else if (docName.isEmpty()) {
+        docName = QFileInfo(job.txtFile).fileName();
+    }
+
+    // Jump to the first page, the rows before it in its line are dropped and
+    // after the last page we stop
+    qint64 skipRows = 0;
+    qint64 maxRows = -1;
+    if (job.firstPage > 0) {
+        if (! seekPage(job, &skipRows)) {
+            m_source.close();
+            return false;
+        }
+        if (job.lastPage > 0) maxRows = qint64(job.lastPage - job.firstPage + 1) * m_setup.maxLines;
+    }
+
+    // Each volume is a PDF of its own, one after the other
+    if (job.volumePages > 0 or job.volumeBytes > 0) {
+        const bool success = renderVolumes(job, docName);
+        closeSource();
+        return success;
+    }
+
+    // No need to collect all, each line is printed and forgotten
+    const bool success = render(job.pdfFile, job.output, docName, [this, skipRows, maxRows](Renderer *renderer) {
+        if (skipRows > 0 or maxRows >= 0) {
+            feedRange(renderer, skipRows, maxRows);
+            return;
+        }
+
+        QStringView line;
+        if (! m_stats) {
+            while (m_source.readLine(&line)) {
+                renderer->addLine(line);
+            }
+            return;
+        }
+
+        // Same as above, but the clock is running
+        m_stats->enter(Stats::Read);
+        while (m_source.readLine(&line)) {
+            m_stats->enter(Stats::Layout);
+            renderer->addLine(line);
+            m_stats->enter(Stats::Read);
+        }
+    });
+
+    // The PDF is fine, but the text is not complete
+    const bool readError = m_source.hasReadError();
+    closeSource();
+    if (success and readError) {
+        m_errorString = "Can't read all of the text: " + (job.txtFile.isEmpty() ? QString("<stdin>") : job.txtFile);
+        return false;
+    }
+
+    return success;
+}
+
+void Converter::closeSource()
+{
+    if (m_stats) {
+        m_stats->bytesRead += m_source.bytesRead();
+        m_stats->linesRead += m_source.linesRead();
+    }
+
+    m_source.close();
+}
+
+// Fill the volumes one by one. A volume ends with a page, so a line may be cut
+// there and its rest begins the next one. When the size is the limit, we look
+// at the file after each page. The renderers write a page not before the next
+// one begins, so a volume will be a page bigger than asked
+bool Converter::renderVolumes(const ConvertJob &job, const QString &docName)
+{
+    const qint64 maxRows = qint64(job.volumePages) * m_setup.maxLines;
+    QString carry;          // Rest of a line, or the line we peeked at
+    bool hasCarry = false;
+    bool atEnd = false;
+    int volume = 1;
+
+    for ( ; ! atEnd; ++volume) {
+        // Not for the first one, even without any text we want one page
+        if (volume > 1 and ! hasCarry) {
+            QStringView line;
+            if (! m_source.readLine(&line)) break;
+            carry = line.toString();
+            hasCarry = true;
+        }
+
+        const QString pdfFile = volumeName(job.pdfFile, volume);
+        const bool success = render(pdfFile, nullptr, docName, [&](Renderer *renderer) {
+            qint64 rows = 0;
+            auto isFull = [&]() {
+                if (rows == 0 or rows % m_setup.maxLines) return false;
+                return (maxRows > 0 and rows >= maxRows) or (job.volumeBytes > 0 and m_pdfFile.pos() >= job.volumeBytes);
+            };
+
+            if (m_stats) m_stats->enter(Stats::Read);
+            for (;;) {
+                QStringView line;
+                if (hasCarry) {
+                    line = carry;
+                    hasCarry = false;
+                } else if (! m_source.readLine(&line)) {
+                    atEnd = true;
+                    return;
+                }
+
+                // Feed the line piece by piece up to each page end, so we can
+                // stop at any of them
+                if (m_stats) m_stats->enter(Stats::Layout);
+                line = TextLayout::expandTabs(line, m_tabBuffer);
+                qint64 lineRows = TextLayout::rowCount(line, m_setup.maxChar);
+                for (;;) {
+                    if (isFull()) {
+                        carry = line.toString();
+                        hasCarry = true;
+                        return;
+                    }
+                    const qint64 pageRows = m_setup.maxLines - rows % m_setup.maxLines;
+                    if (lineRows <= pageRows) {
+                        renderer->addLine(line);
+                        rows += lineRows;
+                        break;
+                    }
+                    const qsizetype cut = TextLayout::rowStart(line, m_setup.maxChar, pageRows);
+                    renderer->addLine(line.first(cut));
+                    rows += pageRows;
+                    lineRows -= pageRows;
+                    line = line.sliced(cut);
+                }
+                if (m_stats) m_stats->enter(Stats::Read);
+            }
+        });
+
+        if (! success) return false;
+        if (job.volumes) *job.volumes << pdfFile;
+    }
+
+    // The loop counted one beyond the last written volume
+    removeVolumesAfter(job.pdfFile, volume - 1);
+    return true;
+}
+
+bool Converter::seekPage(const ConvertJob &job, qint64 *skipRows)
+{
+    if (job.txtFile.isEmpty() or ! m_source.isMapped()) {
+        m_errorString = "Page range needs a text file: " + job.pdfFile;
+        return false;
+    }
+
+    // The index may be outdated or belong to other settings, then we count
+    PageStart start;
+    start.offset = job.startOffset;
+    start.rowSkip = job.startRowSkip;
+    bool found = job.startOffset >= 0;
+    if (! found and ! job.pageIndex.isEmpty()) {
+        found = lookupPageIndex(job.pageIndex, job.firstPage, m_setup.maxChar, m_setup.maxLines, job.txtFile, &start)
+                and m_source.seek(start.offset);
+    }
+
+    if (! found) {
+        countPages(&m_source, m_setup.maxChar, m_setup.maxLines, [&](const PageStart &page) {
+            if (page.page < job.firstPage) return true;
+            start = page;
+            found = true;
+            return false;
+        });
+    }
+
+    if (! found or ! m_source.seek(start.offset)) {
+        m_errorString = QString("%1: Text has less than %2 pages").arg(job.txtFile).arg(job.firstPage);
+        return false;
+    }
+
+    *skipRows = start.rowSkip;
+    return true;
+}
+
+void Converter::feedRange(Renderer *renderer, qint64 skipRows, qint64 maxRows)
+{
+    // Cut the lines at the row where the range starts and ends. Tabs must be
+    // expanded first or the rows would not fit
+    if (m_stats) m_stats->enter(Stats::Read);
+    QStringView line;
+    while (maxRows != 0 and m_source.readLine(&line)) {
+        line = TextLayout::expandTabs(line, m_tabBuffer);
+        qint64 rows = TextLayout::rowCount(line, m_setup.maxChar);
+        if (skipRows > 0) {
+            line = line.sliced(TextLayout::rowStart(line, m_setup.maxChar, skipRows));
+            rows -= skipRows;
+            skipRows = 0;
+        }
+        if (maxRows > 0 and rows > maxRows) {
+            line = line.first(TextLayout::rowStart(line, m_setup.maxChar, maxRows));
+            rows = maxRows;
+        }
+
+        if (m_stats) m_stats->enter(Stats::Layout);
+        renderer->addLine(line);
+        if (m_stats) m_stats->enter(Stats::Read);
+        if (maxRows > 0) maxRows -= rows;
+    }
+}
+
+bool Converter::convert(const QStringList &lines, const QString &pdfFile)
+{
+    return render(pdfFile, nullptr, QString(), [&lines](Renderer *renderer) {
+        for (const QString &line : lines) {
+            renderer->addLine(line);
+        }
+    });
+}
+
+bool Converter::render(const QString &pdfFile, QIODevice *output, const QString &docName, const std::function<void(Renderer *)> &feed)
+{
+    // Both writers never seek, so stdout may be a pipe and the pages flow out
+    // while the input is still coming in
+    QIODevice *device = output ? output : &m_pdfFile;
+    if (output) {
+        // Already open by the caller
+    } else if (pdfFile == "-") {
+        if (! m_pdfFile.open(stdout, QIODevice::WriteOnly)) {
+            m_errorString = "Can't write PDF to stdout: " + m_pdfFile.errorString();
+            return false;
+        }
+    } else {
+        m_pdfFile.setFileName(pdfFile);
+        if (! m_pdfFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            m_errorString = "Can't create PDF file: " + pdfFile;
+            return false;
+        }
+    }
+
+    // Unlike QPrinter is QPdfWriter cheap to create, it don't ask the print
+    // system for the default printer, so we can take a new one for each file
+    std::unique_ptr<QPdfWriter> pdfWriter;
+    std::unique_ptr<Renderer> renderer;
+
+    if (m_setup.backend == PageSetup::NativeBackend) {
+        auto pdfRenderer = std::make_unique<PdfRenderer>(device, m_font, m_setup);
+        pdfRenderer->setDocName(docName);
+        pdfRenderer->setThreads(m_threads);
+        renderer = std::move(pdfRenderer);
+    } else {
+        pdfWriter = std::make_unique<QPdfWriter>(device);
+        m_setup.applyTo(pdfWriter.get());
+        pdfWriter->setTitle(docName);
+        auto textRenderer = std::make_unique<TextRenderer>(pdfWriter.get(), m_font, m_setup.maxChar, m_setup.maxLines);
+        textRenderer->setThreads(m_threads);
+        renderer = std::move(textRenderer);
+    }
+
+    renderer->setStats(m_stats);
+    if (m_stats) m_stats->enter(Stats::Print);
+
+    bool success = renderer->begin();
+    if (success) {
+        feed(renderer.get());
+        success = renderer->finish();
+    }
+
+    if (! success) m_errorString = pdfFile + ": " + renderer->errorString();
+
+    if (m_stats) {
+        m_stats->enter(Stats::Write);
+        m_stats->pages += renderer->pageCount();
+        if (! device->isSequential()) m_stats->outputBytes += device->pos();
+        ++m_stats->files;
+    }
+
+    renderer.reset();
+    pdfWriter.reset();
+    m_pdfFile.close();
+    if (m_stats) m_stats->stop();
+
+    return success;
+}
+
+// The PDF is continued by an incremental update: The last page is replaced,
+// because it may get more rows now, and new pages are appended. Where we are
+// is kept in a state file beside the PDF. If anything doesn't fit, the PDF
+// or the text was changed in some other way, we start over
+bool Converter::update(const ConvertJob &job)
+{
+    if (m_setup.backend != PageSetup::NativeBackend) {
+        m_errorString = "Update is only supported by the native backend";
+        return false;
+    }
+
+    QSettings settings(job.pdfFile + ".state", QSettings::IniFormat);
+    const QFileInfo txtInfo(job.txtFile);
+    const QFileInfo pdfInfo(job.pdfFile);
+
+    PdfResumeState state;
+    qint64 txtDone = 0;
+    // The PDF is the one we made last time, unchanged since
+    const bool ownPdf = settings.value("txtFile").toString() == job.txtFile
+                        and pdfInfo.size() == settings.value("pdfSize").toLongLong()
+                        and pdfInfo.lastModified().toMSecsSinceEpoch() == settings.value("pdfModified").toLongLong();
+    bool canResume = ownPdf
+                     and settings.value("version").toInt() == UpdateStateVersion
+                     and settings.value("layout").toString() == layoutKey(m_setup)
+                     and settings.value("objectStreams").toBool() == m_setup.objectStreams;
+
+    if (canResume) {
+        txtDone = settings.value("txtSize").toLongLong();
+        state.fileSize = settings.value("pdfSize").toLongLong();
+        state.xrefPos = settings.value("xrefPos").toLongLong();
+        state.objectCount = settings.value("objectCount").toInt();
+        state.pagesId = settings.value("pagesId").toInt();
+        state.catalogId = settings.value("catalogId").toInt();
+        state.infoId = settings.value("infoId").toInt();
+        state.fontId = settings.value("fontId").toInt();
+        state.fontState = settings.value("fontState").toByteArray();
+        state.lastPageOffset = settings.value("lastPageOffset").toLongLong();
+        state.lastPageRowSkip = settings.value("lastPageRowSkip").toInt();
+        const QStringList pageIds = settings.value("pageIds").toString().split(' ', Qt::SkipEmptyParts);
+        for (const QString &id : pageIds) state.pageIds << id.toInt();
+
+        canResume = txtInfo.size() >= txtDone
+                    and tailHash(job.txtFile, state.lastPageOffset, txtDone) == settings.value("tailHash").toByteArray();
+    }
+
+    // Without a fitting state may the PDF be anything, it's not ours to replace
+    if (! ownPdf and pdfInfo.exists() and ! job.overwrite) {
+        m_errorString = QString("File already exist and has no valid update state: %1\n"
+                                "Use --force to start over").arg(job.pdfFile);
+        return false;
+    }
+    if (! canResume and pdfInfo.exists()) {
+        m_warningString = "Can't continue, starting over: " + job.pdfFile;
+    }
+
+    // Nothing new, nothing to do
+    if (canResume and txtInfo.size() == txtDone) return true;
+
+    if (! m_source.open(job.txtFile)) {
+        m_errorString = QString("Can't read %1: %2").arg(job.txtFile, m_source.errorString());
+        return false;
+    }
+    if (canResume) canResume = m_source.seek(state.lastPageOffset);
+
+    m_pdfFile.setFileName(job.pdfFile);
+    if (! m_pdfFile.open(canResume ? QIODevice::WriteOnly | QIODevice::Append : QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = "Can't create PDF file: " + job.pdfFile;
+        m_source.close();
+        return false;
+    }
+
+    if (m_stats) m_stats->enter(Stats::Print);
+    PdfRenderer renderer(&m_pdfFile, m_font, m_setup);
+    renderer.setStats(m_stats);
+    renderer.setThreads(m_threads);
+    renderer.setDocName(txtInfo.fileName());
+
+    bool success = canResume ? renderer.resume(state) : renderer.begin();
+    if (success) {
+        QStringView line;
+        qint64 pos = m_source.bytesRead();
+        while (m_source.readLine(&line)) {
+            renderer.setSourcePos(pos);
+            renderer.addLine(line);
+            pos = m_source.bytesRead();
+        }
+        success = renderer.finish();
+    }
+
+    const qint64 txtSize = m_source.bytesRead();
+    if (m_stats) {
+        m_stats->enter(Stats::Write);
+        m_stats->bytesRead += txtSize - (canResume ? state.lastPageOffset : 0);
+        m_stats->linesRead += m_source.linesRead();
+        m_stats->pages += renderer.pageCount();
+        ++m_stats->files;
+    }
+    m_source.close();
+    m_pdfFile.close();
+
+    if (! success) {
+        m_errorString = job.pdfFile + ": " + renderer.errorString();
+        settings.clear();
+        if (m_stats) m_stats->stop();
+        return false;
+    }
+
+    state = renderer.state();
+    QStringList pageIds;
+    for (const int id : std::as_const(state.pageIds)) pageIds << QString::number(id);
+
+    settings.clear();
+    settings.setValue("version", UpdateStateVersion);
+    settings.setValue("layout", layoutKey(m_setup));
+    // Don't mix xref table and stream, who knows which reader gets confused
+    settings.setValue("objectStreams", m_setup.objectStreams);
+    settings.setValue("txtFile", job.txtFile);
+    settings.setValue("txtSize", txtSize);
+    settings.setValue("tailHash", tailHash(job.txtFile, state.lastPageOffset, txtSize));
+    settings.setValue("pdfSize", state.fileSize);
+    settings.setValue("pdfModified", QFileInfo(job.pdfFile).lastModified().toMSecsSinceEpoch());
+    settings.setValue("xrefPos", state.xrefPos);
+    settings.setValue("objectCount", state.objectCount);
+    settings.setValue("pagesId", state.pagesId);
+    settings.setValue("catalogId", state.catalogId);
+    settings.setValue("infoId", state.infoId);
+    settings.setValue("fontId", state.fontId);
+    settings.setValue("fontState", state.fontState);
+    settings.setValue("lastPageOffset", state.lastPageOffset);
+    settings.setValue("lastPageRowSkip", state.lastPageRowSkip);
+    settings.setValue("pageIds", pageIds.join(' '));
+    settings.sync();
+
+    if (m_stats) m_stats->stop();
+
+    if (settings.status() != QSettings::NoError) {
+        m_errorString = "Can't write state file: " + settings.fileName();
+        return false;
+    }
+
+    return true;
+}
+
+bool splitJob(const PageSetup &setup, const ConvertJob &job, QList<ConvertJob> *volumes, QString *errorString)
+{
+    TextSource source;
+    if (! source.open(job.txtFile)) {
+        *errorString = QString("Can't read %1: %2").arg(job.txtFile, source.errorString());
+        return false;
+    }
+    if (! job.overwrite and ! volumesAfter(job.pdfFile, 0).isEmpty()) {
+        *errorString = QString("Volumes already exist: %1\nUse --force if you don't care").arg(volumeName(job.pdfFile, 1));
+        return false;
+    }
+
+    int count = 0;
+    countPages(&source, setup.maxChar, setup.maxLines, [&](const PageStart &start) {
+        if ((start.page - 1) % job.volumePages) return true;
+
+        ConvertJob volume = job;
+        volume.pdfFile = volumeName(job.pdfFile, ++count);
+        volume.firstPage = start.page;
+        volume.lastPage = start.page + job.volumePages - 1;
+        volume.startOffset = start.offset;
+        volume.startRowSkip = start.rowSkip;
+        volume.volumePages = 0;
+        volume.volumes = nullptr;
+        *volumes << volume;
+        return true;
+    });
+    removeVolumesAfter(job.pdfFile, count);
+
+    return true;
+}
+
+bool convertJobs(const PageSetup &setup, const QList<ConvertJob> &jobs, int threads
+               , const std::function<void(const QString &)> &errorFunc, Stats *stats
+               , ResultCache *cache)
+{
+    // All entries of a batch may be dropped already, nothing left to fail
+    if (jobs.isEmpty()) return true;
+
+    const int pageThreads = qMax(1, threads / int(jobs.size()));
+    threads = qBound(1, threads, int(jobs.size()));
+
+    std::vector<std::unique_ptr<Converter>> converters;
+    std::vector<Stats> converterStats(stats ? threads : 0);
+    for (int i = 0; i < threads; ++i) {
+        converters.push_back(std::make_unique<Converter>(setup));
+        converters.back()->setThreads(pageThreads);
+        converters.back()->setResultCache(cache);
+        if (stats) converters.back()->setStats(&converterStats[i]);
+    }
+
+    QMutex errorMutex;
+    bool success = true;
+    QAtomicInteger<qsizetype> nextJob = 0;
+
+    // Each worker takes the next job until all are done. This way is a big
+    // file no problem, the others keep busy with the small ones
+    auto work = [&](Converter *converter) {
+        for (qsizetype i = nextJob.fetchAndAddRelaxed(1); i < jobs.size(); i = nextJob.fetchAndAddRelaxed(1)) {
+            const bool done = converter->convert(jobs.at(i));
+            if (done and converter->warningString().isEmpty()) continue;
+
+            QMutexLocker locker(&errorMutex);
+            success = success and done;
+            errorFunc(done ? converter->warningString() : converter->errorString());
+        }
+    };
+
+    if (threads == 1) {
+        work(converters.front().get());
+    } else {
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        for (const auto &converter : converters) {
+            pool.start([&work, c = converter.get()]() { work(c); });
+        }
+        pool.waitForDone();
+    }
+
+    for (const Stats &s : converterStats) stats->add(s);
+
+    return success;
+}
@@ -0,0 +1,122 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+#include <QFile>
+#include <QFont>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+#include "textsource.h"
+
+class Renderer;
+class ResultCache;
+class Stats;
+struct PageSetup;
+
+struct ConvertJob
+{
+    QString txtFile;    // Empty means stdin...
+    QString pdfFile;    // - means stdout...
+    const QByteArray *input = nullptr;  // ...or this when set
+    QIODevice *output = nullptr;        // ...or this when set
+    bool update = false;    // Only append what was added to txtFile since the last update
+    bool overwrite = true;  // When false, an existing pdfFile is only continued by an update
+    TextSource::PullFunc pull;  // Instead of stdin, ask this for the text
+    QString title;          // Of the PDF, by default the name of txtFile
+    int firstPage = 0;      // Only these pages when set, counted from 1, lastPage 0 is up to the end
+    int lastPage = 0;
+    QString pageIndex;      // Written by --page-index, to find firstPage at once
+    qint64 startOffset = -1;    // Where firstPage begins, when already known...
+    qint64 startRowSkip = 0;    // ...and its rows on the page before
+    int volumePages = 0;    // Split into volumes of that many pages...
+    qint64 volumeBytes = 0; // ...or about that size
+    QStringList *volumes = nullptr; // Filled with the names of the volumes
+};
+
+// The name of a volume of pdfFile, foo.pdf gives foo-001.pdf and so on
+QString volumeName(const QString &pdfFile, int volume);
+
+// Turn text files into PDFs, as many as you like. The font and input buffers
+// are set up once and reused for each file.
+// A Converter is not thread safe, but each thread may have its own
+class Converter
+{
+public:
+    explicit Converter(const PageSetup &setup);
+
+    // Threads used to render the pages of one file
+    void setThreads(int threads) { m_threads = threads; }
+    // Collect what each convert() cost, leave it nullptr when you don't care
+    void setStats(Stats *stats) { m_stats = stats; }
+    // Skip what was already done before, nullptr to always convert
+    void setResultCache(ResultCache *cache);
+
+    bool convert(const ConvertJob &job);
+    bool convert(const QStringList &lines, const QString &pdfFile);
+
+    QString errorString() const { return m_errorString; }
+    // Of the last convert(), something the user should know but no failure
+    QString warningString() const { return m_warningString; }
+
+private:
+    bool render(const QString &pdfFile, QIODevice *output, const QString &docName, const std::function<void(Renderer *)> &feed);
+    bool convertText(const ConvertJob &job);
+    bool update(const ConvertJob &job);
+    bool seekPage(const ConvertJob &job, qint64 *skipRows);
+    bool renderVolumes(const ConvertJob &job, const QString &docName);
+    void closeSource();
+    void feedRange(Renderer *renderer, qint64 skipRows, qint64 maxRows);
+
+    const PageSetup &m_setup;
+    QFile            m_pdfFile;
+    QFont            m_font;
+    TextSource       m_source;
+    QString          m_tabBuffer;
+    QString          m_errorString;
+    QString          m_warningString;
+    Stats           *m_stats = nullptr;
+    ResultCache     *m_resultCache = nullptr;
+    QByteArray       m_resultKey;
+    int              m_threads = 1;
+};
+
+// Convert all jobs by up to threads Converters at the same time. When there are
+// less jobs than threads, the rest is used to render the pages of each file.
+// Any error or warning is reported to errorFunc, one by one, never in parallel.
+// When stats is given, the stats of all jobs are added to it.
+// When cache is given, jobs which are already done are skipped.
+// Return false if any job failed
+bool convertJobs(const PageSetup &setup, const QList<ConvertJob> &jobs, int threads
+               , const std::function<void(const QString &)> &errorFunc, Stats *stats = nullptr
+               , ResultCache *cache = nullptr);
+
+// Replace job, which must have volumePages and a text file, by a job for each of
+// its volumes. So the volumes can be done by convertJobs() in parallel.
+// The begin of each volume is found by a quick count, see countPages().
+// Volumes of an earlier run beyond the new count are removed
+bool splitJob(const PageSetup &setup, const ConvertJob &job, QList<ConvertJob> *volumes, QString *errorString);
+
+#endif
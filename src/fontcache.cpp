@@ -0,0 +1,144 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "fontcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+FontCache::FontCache()
+    : m_settings(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/fonts.cache", QSettings::IniFormat)
+{
+}
+
+void FontCache::validate()
+{
+    if (m_validated) return;
+    m_validated = true;
+
+    const QByteArray state = systemFontState();
+    if (m_settings.value("state").toByteArray() == state) return;
+
+    m_settings.clear();
+    m_settings.setValue("state", state);
+}
+
+QByteArray FontCache::systemFontState()
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray(QT_VERSION_STR));
+    hash.addData(qgetenv("FONTCONFIG_FILE"));
+    hash.addData(qgetenv("FONTCONFIG_PATH"));
+
+    auto addTime = [&hash](const QFileInfo &info) {
+        hash.addData(info.absoluteFilePath().toUtf8());
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    };
+
+    // Config files. To watch the directories is enough to notice new or
+    // removed files, the files itself tell about changes in them
+    QStringList configs{"/etc/fonts", "/etc/fonts/conf.d", QDir::homePath() + "/.config/fontconfig"};
+    for (const QString &config : std::as_const(configs)) {
+        const QDir dir(config);
+        if (! dir.exists()) continue;
+        addTime(QFileInfo(config));
+        const QFileInfoList files = dir.entryInfoList(QDir::Files, QDir::Name);
+        for (const QFileInfo &info : files) addTime(info);
+    }
+
+    // Font directories, exactly what fontconfig check to find out if its own
+    // cache is still valid
+    QStringList fontDirs = QStandardPaths::standardLocations(QStandardPaths::FontsLocation);
+    fontDirs << "/usr/share/fonts" << "/usr/local/share/fonts" << QDir::homePath() + "/.fonts";
+    fontDirs.removeDuplicates();
+    for (const QString &fontDir : std::as_const(fontDirs)) {
+        if (! QFileInfo::exists(fontDir)) continue;
+        addTime(QFileInfo(fontDir));
+        QDirIterator it(fontDir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            addTime(it.nextFileInfo());
+        }
+    }
+
+    return hash.result().toHex();
+}
+
+QString FontCache::key(const QString &family, const QString &style, int size, int resolution)
+{
+    // As group name, which should be free of any funny char
+    const QString request = QString("%1|%2|%3|%4").arg(family, style).arg(size).arg(resolution);
+    return QCryptographicHash::hash(request.toUtf8(), QCryptographicHash::Md5).toHex();
+}
+
+bool FontCache::lookup(const QString &key, FontMetrics *metrics)
+{
+    validate();
+
+    m_settings.beginGroup(key);
+    const bool found = m_settings.contains("advance");
+    if (found) {
+        metrics->family = m_settings.value("family").toString();
+        metrics->styleName = m_settings.value("style").toString();
+        metrics->pointSize = m_settings.value("pointSize").toInt();
+        metrics->fixedPitch = m_settings.value("fixedPitch").toBool();
+        metrics->advance = m_settings.value("advance").toReal();
+        metrics->height = m_settings.value("height").toReal();
+        metrics->ascent = m_settings.value("ascent").toReal();
+    }
+    m_settings.endGroup();
+
+    return found;
+}
+
+void FontCache::insert(const QString &key, const FontMetrics &metrics)
+{
+    validate();
+
+    m_settings.beginGroup(key);
+    m_settings.setValue("family", metrics.family);
+    m_settings.setValue("style", metrics.styleName);
+    m_settings.setValue("pointSize", metrics.pointSize);
+    m_settings.setValue("fixedPitch", metrics.fixedPitch);
+    m_settings.setValue("advance", metrics.advance);
+    m_settings.setValue("height", metrics.height);
+    m_settings.setValue("ascent", metrics.ascent);
+    m_settings.endGroup();
+}
+
+bool FontCache::fontList(QString *list)
+{
+    validate();
+
+    if (! m_settings.contains("fontList")) return false;
+    *list = m_settings.value("fontList").toString();
+
+    return true;
+}
+
+void FontCache::setFontList(const QString &list)
+{
+    validate();
+    m_settings.setValue("fontList", list);
+}
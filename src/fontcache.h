@@ -0,0 +1,65 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef FONTCACHE_H
+#define FONTCACHE_H
+
+#include <QSettings>
+#include <QString>
+
+// What we need to know about a resolved font, so we don't need to ask
+// fontconfig each time. Metrics are in pixel at the resolution of the key
+struct FontMetrics
+{
+    QString family;
+    QString styleName;
+    int     pointSize = 0;
+    bool    fixedPitch = false;
+    qreal   advance = 0.0;
+    qreal   height = 0.0;
+    qreal   ascent = 0.0;
+};
+
+// Remember resolved fonts and the font list on disk. The cache is thrown away
+// as soon as anything changed which fontconfig would notice, that is its
+// config files and the modification time of the font directories
+class FontCache
+{
+public:
+    FontCache();
+
+    bool lookup(const QString &key, FontMetrics *metrics);
+    void insert(const QString &key, const FontMetrics &metrics);
+
+    bool fontList(QString *list);
+    void setFontList(const QString &list);
+
+    static QString key(const QString &family, const QString &style, int size, int resolution);
+
+private:
+    void validate();
+    static QByteArray systemFontState();
+
+    QSettings m_settings;
+    bool      m_validated = false;
+};
+
+#endif
@@ -21,8 +21,6 @@
 
 #define MY_NAME "wrt2pdf"
 #define MY_VERSION "0.6.1"
-#define MY_FONTFAMILY "Hack"
-#define MY_FONTSIZE 10
 
 //  My start point for this little project
 //    https://wiki.qt.io/Exporting_a_document_to_PDF
@@ -35,66 +33,301 @@
 //   https://doc.qt.io/qt-5/qstring.html#QStringLiteral
 // - Perhaps make translations possible after all?
 
-#include <QApplication>
+#include <QBuffer>
 #include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
 #include <QFileInfo>
 #include <QFontDatabase>
 #include <QFontInfo>
 #include <QFontMetricsF>
-#include <QTextDocument>
+#include <QGuiApplication>
+#include <QHash>
 #include <QTextStream>
-#ifndef QT_NO_PRINTER
-#include <QPrinter>
+#include <QThread>
+
+#include <memory>
+#include <vector>
+
+#include "converter.h"
+#include "fontcache.h"
+#include "pagesetup.h"
+#include "paginator.h"
+#include "pdfrenderer.h"
+#include "resultcache.h"
+#include "server.h"
+#include "stats.h"
+#include "textsource.h"
+
+#ifdef WRT2PDF_COUNT_ALLOCATIONS
+qint64 mallocCount(); // See malloccounter.cpp
 #endif
 
+// While --serve runs a request goes all output to the client
+static QTextStream *s_requestOut = nullptr;
+static QTextStream *s_requestErr = nullptr;
+
 // https://newbedev.com/how-to-print-to-console-when-using-qt
 inline QTextStream& qStdOut()
 {
     static QTextStream r{stdout};
-    return r;
+    return s_requestOut ? *s_requestOut : r;
 }
 
 inline QTextStream& qStdErr()
 {
     static QTextStream r{stderr};
-    return r;
+    return s_requestErr ? *s_requestErr : r;
 }
 
-inline qreal mmToPoints(const qreal& mm) {
-    return (mm * 72/25.4);
+// What outlive a single command, which is only of interest for --serve
+struct Session
+{
+    const QByteArray *input = nullptr;  // Instead of stdin when set
+    QIODevice        *output = nullptr; // Instead of stdout when set
+    QStringList       pdfFiles;         // Created by the last command
+    Stats             stats;            // Of the last command
+    std::unique_ptr<FontCache> fontCache;
+    QHash<QString, std::shared_ptr<PageSetup>> setups;
+};
+
+// Place the PDF beside the text file
+inline QString pdfNameOf(const QFileInfo &txtInfo) {
+    return txtInfo.canonicalPath() + "/" + txtInfo.completeBaseName() + ".pdf";
 }
 
-int main(int argc, char *argv[])
+// Add the .pdf suffix if missing
+inline QString pdfNameFrom(const QString &name) {
+    if (name.endsWith(".pdf")) return name;
+    const QFileInfo info(name);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".pdf";
+}
+
+// The page index is written when counting, but read by --pages
+inline bool countsOnly(const QCommandLineParser &parser) {
+    return parser.isSet("count-pages") or (parser.isSet("page-index") and ! parser.isSet("pages"));
+}
+
+// Parse 'A-B', 'A' or 'A-', last is 0 for up to the end
+static bool parsePageRange(const QString &range, int *first, int *last)
 {
-    QApplication app(argc, argv);
-    QCoreApplication::setApplicationName(MY_NAME);
-    QCoreApplication::setApplicationVersion(MY_VERSION);
+    bool ok1 = true;
+    bool ok2 = true;
+    *first = range.section('-', 0, 0).toInt(&ok1);
+    if (! range.contains('-')) {
+        *last = *first;
+    } else if (range.section('-', 1).isEmpty()) {
+        *last = 0;
+    } else {
+        *last = range.section('-', 1).toInt(&ok2);
+    }
 
-    QCommandLineParser parser;
+    return ok1 and ok2 and *first > 0 and (*last == 0 or *last >= *first);
+}
+
+// Fill jobs by given text files and/or manifest. A bad entry is reported and
+// set failed, but the others are kept. Return false if there is nothing to do
+static bool collectBatchJobs(const QCommandLineParser &parser, const QByteArray *input, QList<ConvertJob> *jobs, bool *failed)
+{
+    QStringList entries = parser.positionalArguments();
+    if (parser.isSet("in-file")) entries.prepend(parser.value("in-file"));
+
+    if (parser.isSet("manifest")) {
+        QFile manifest;
+        QBuffer buffer;
+        QIODevice *device = &manifest;
+        const QString manifestFile = parser.value("manifest");
+        if (manifestFile == "-" and input) {
+            buffer.setData(*input);
+            buffer.open(QIODevice::ReadOnly);
+            device = &buffer;
+        } else if (manifestFile == "-") {
+            manifest.open(stdin, QIODevice::ReadOnly);
+        } else {
+            manifest.setFileName(manifestFile);
+            if (! manifest.open(QIODevice::ReadOnly)) {
+                qStdErr() << "Can't read manifest: " << manifestFile << Qt::endl;
+                return false;
+            }
+        }
+
+        QTextStream in(device);
+        QString line;
+        while (in.readLineInto(&line)) {
+            if (line.trimmed().isEmpty() or line.startsWith('#')) continue;
+            entries << line;
+        }
+    }
+
+    for (const QString &entry : std::as_const(entries)) {
+        // A manifest line may have a TAB separated [pdf-to-create]
+        const QString txtFile = entry.section('\t', 0, 0);
+        const QString pdfFile = entry.section('\t', 1, 1).trimmed();
+
+        QFileInfo info(txtFile);
+        if (! info.isFile()) {
+            qStdErr() << "TXT file not found: " << txtFile << Qt::endl;
+            *failed = true;
+            continue;
+        }
+
+        ConvertJob job;
+        job.txtFile = info.canonicalFilePath();
+        if (pdfFile == "-") {
+            qStdErr() << "Can't write to stdout in batch mode: " << txtFile << Qt::endl;
+            *failed = true;
+            continue;
+        } else if (pdfFile.isEmpty()) {
+            // Like -i, no override check
+            job.pdfFile = pdfNameOf(info);
+        } else {
+            // The Converter check if it exist, after the cache had its chance
+            job.pdfFile = pdfNameFrom(pdfFile);
+        }
+        job.update = parser.isSet("update");
+        // An update may continue its own PDF, but not replace a foreign one
+        job.overwrite = parser.isSet("force") or (pdfFile.isEmpty() and ! job.update);
+        *jobs << job;
+    }
+
+    if (jobs->isEmpty()) {
+        qStdErr() << "Nothing to do, no text files given" << Qt::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Resolving costs most of the start up. A server keep all it had done, so any
+// later request with the same font and page is for free
+static const PageSetup &resolvedSetup(const PageSetup &wanted, FontCache *fontCache, Session *session)
+{
+    const QMarginsF &m = wanted.margins;
+    const QString key = QString("%1|%2|%3|%4|%5|%6|%7,%8,%9,%10|%11|%12")
+                        .arg(wanted.fontFamily, wanted.fontStyle).arg(wanted.fontSize)
+                        .arg(wanted.pageSize.key()).arg(int(wanted.pageOrientation)).arg(int(wanted.backend))
+                        .arg(m.left()).arg(m.top()).arg(m.right()).arg(m.bottom())
+                        .arg(wanted.compression).arg(wanted.objectStreams);
+
+    std::shared_ptr<PageSetup> &setup = session->setups[key];
+    if (! setup) {
+        setup = std::make_shared<PageSetup>(wanted);
+        setup->resolve(fontCache);
+    }
+
+    return *setup;
+}
 
+static void addOptions(QCommandLineParser *parser)
+{
     // We don't use "translate" stuff, 1) I'm too lazy 2) localized help text is more a pain than a plus
-    parser.addPositionalArgument("pdf-to-create", "The suffix .pdf will be added automatically when missing", "[pdf-to-create]");
-    parser.addPositionalArgument("text-file", "File to be converted. When not given stdin is used", "[text-file]");
+    parser->addPositionalArgument("pdf-to-create", "The suffix .pdf will be added automatically when missing. Use - for stdout", "[pdf-to-create]");
+    parser->addPositionalArgument("text-file", "File to be converted. When not given stdin is used", "[text-file]");
     // Qt doku says: C++11-style uniform initialization
-    parser.addOption({{"F", "force"}, "Overwrite existing file [pdf-to-create]"});
-    parser.addOption({{"i", "in-file"}, "File to be converted. When no [pdf-to-create] is given <file-name> is used with .pdf suffix", "file-name"});
-    parser.addOption({{"f", "font"}, "Set the font to use by description", "font-desc"});
-    parser.addOption({{"L", "list-fonts"}, "List available fixed pitch fonts"});
-    parser.addOption({{"m", "margins"}, "Set the page margins in millimeter as string 'left,right,top,bottom'", "l,r,t,b", "5.0,5.0,5.0,5.0"});
-    parser.addOption({{"p", "page-size"}, "Set the paper size by PPD media option keyword", "mok"});
-    parser.addOption({{"P", "list-mo-keys"}, "List PPD media option keywords (mok) and description", "key-filter"});
-    parser.addOption({{"l", "landscape"}, "Use page in landscape orientation"});
-    parser.addOption({{"I", "info"}, "Like a dry-run, shows settings and resulting page size in rows/cols"});
-    parser.addOption({{"T", "test-page"}, "Generate a test page to verify intended settings, similar to -I"});
-    parser.addVersionOption(); // Argh, this shows localized help text FIXME
+    parser->addOption({{"F", "force"}, "Overwrite existing file [pdf-to-create]"});
+    parser->addOption({{"i", "in-file"}, "File to be converted. When no [pdf-to-create] is given <file-name> is used with .pdf suffix", "file-name"});
+    parser->addOption({{"f", "font"}, "Set the font to use by description", "font-desc"});
+    parser->addOption({{"L", "list-fonts"}, "List available fixed pitch fonts"});
+    parser->addOption({"no-font-cache", "Don't use or update the cache of resolved fonts"});
+    parser->addOption({{"m", "margins"}, "Set the page margins in millimeter as string 'left,right,top,bottom'", "l,r,t,b", "5.0,5.0,5.0,5.0"});
+    parser->addOption({{"p", "page-size"}, "Set the paper size by PPD media option keyword", "mok"});
+    parser->addOption({{"P", "list-mo-keys"}, "List PPD media option keywords (mok) and description", "key-filter"});
+    parser->addOption({{"l", "landscape"}, "Use page in landscape orientation"});
+    parser->addOption({{"b", "backend"}, "How to create the PDF, 'qt' by QPdfWriter, or 'native' which is faster and smaller but support TrueType fonts only", "name", "qt"});
+    parser->addOption({{"z", "compression"}, "Compress the page content by <level>, 0 not at all, 1 fastest up to 9 smallest. Needs --backend native", "level", "6"});
+    parser->addOption({"object-streams", "Pack small objects into compressed object streams, gives smaller PDF 1.5 files. Needs --backend native"});
+    parser->addOption({"split", "Split the PDF into volumes of <N> pages, or with suffix M of about N megabytes. They are named like foo-001.pdf", "N[M]"});
+    parser->addOption({{"C", "cache"}, "Skip any text file whose PDF was made before of the same text and settings, like make but by content"});
+    parser->addOption({"cache-dir", "Like --cache, and keep a copy of each PDF in <dir>, so it can be fetched from there for any name", "dir"});
+    parser->addOption({{"u", "update"}, "Append only what was added to [text-file] since the last update as new pages to [pdf-to-create]. Needs --backend native"});
+    parser->addOption({{"S", "stats"}, "Report time and memory spent by each phase of the conversion on stderr"});
+    parser->addOption({"stats-json", "Like --stats, but as JSON"});
+    parser->addOption({{"c", "count-pages"}, "Don't create any PDF, only print how many pages each [text-file] would give. All arguments are taken as [text-file]"});
+    parser->addOption({"page-index", "Like --count-pages, and write where each page begins to <file>, one line per page as 'page line byte-offset rows-skipped'. With --pages is <file> read to find the first page at once", "file"});
+    parser->addOption({"pages", "Convert only the pages <A-B> of [text-file], 'A' or 'A-' are fine too. The first page is found without any rendering, or by --page-index", "A-B"});
+    parser->addOption({{"I", "info"}, "Like a dry-run, shows settings and resulting page size in rows/cols"});
+    parser->addOption({{"T", "test-page"}, "Generate a test page to verify intended settings, similar to -I"});
+    parser->addOption({{"B", "batch"}, "Convert all given [text-file]s, each one like done by -i"});
+    parser->addOption({{"j", "jobs"}, "Use <N> threads, 0 use all cores. With --batch or --manifest are files converted in parallel, a single file is split into parts of some pages", "N", "1"});
+    parser->addOption({{"M", "manifest"}, "Convert all files listed in <file>, one per line as 'text-file' or 'text-file<TAB>pdf-to-create'. Use - for stdin", "file"});
+    parser->addOption({"serve", "Run as server, listen on local socket <name> for jobs given by --client. Only the same user can connect", "name"});
+    parser->addOption({"client", "Don't do the job but let the server on <name> do it, all other options are passed", "name"});
+    parser->addVersionOption(); // Argh, this shows localized help text FIXME
     // We don't use Qt build-in help option
-    parser.addOption({{"h", "?"}, "Show usage"});
-    parser.addOption({{"H", "help"}, "Show usage, examples and some more hints"});
-    //parser.addOption(moreHelpOption);
+    parser->addOption({{"h", "?"}, "Show usage"});
+    parser->addOption({{"H", "help"}, "Show usage, examples and some more hints"});
+    //parser->addOption(moreHelpOption);
+}
 
-    // Process the actual command line arguments given by the user
-    parser.process(app);
+// Count the pages of each job, that's all. Fast enough to check if a job is
+// worth to be done at all
+static int runCountPages(const QCommandLineParser &parser, const QList<ConvertJob> &jobs, const PageSetup &setup)
+{
+    QFile index;
+    if (parser.isSet("page-index")) {
+        if (jobs.size() > 1) {
+            qStdErr() << "Page index works only with a single text file" << Qt::endl;
+            return 1;
+        }
+        index.setFileName(parser.value("page-index"));
+        if (! index.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qStdErr() << "Can't create page index: " << index.fileName() << Qt::endl;
+            return 1;
+        }
+    }
 
+    int result = 0;
+    TextSource source;
+    for (const ConvertJob &job : jobs) {
+        if (job.txtFile.isEmpty() and job.input) {
+            source.openData(*job.input);
+        } else if (job.txtFile.isEmpty()) {
+            source.openStdin();
+        } else if (! source.open(job.txtFile)) {
+            qStdErr() << "Can't read " << job.txtFile << ": " << source.errorString() << Qt::endl;
+            result = 1;
+            continue;
+        }
+
+        // A later --pages must know if the index still fits, from stdin we can't tell
+        if (index.isOpen() and job.txtFile.isEmpty()) {
+            qStdErr() << "Page index needs a text file, not stdin" << Qt::endl;
+            result = 1;
+            source.close();
+            continue;
+        }
+
+        QByteArray pageLines;
+        const qint64 pages = countPages(&source, setup.maxChar, setup.maxLines, [&index, &pageLines](const PageStart &start) {
+            if (! index.isOpen()) return true;
+            pageLines += QByteArray::number(start.page) + ' ' + QByteArray::number(start.line) + ' '
+                       + QByteArray::number(start.offset) + ' ' + QByteArray::number(start.rowSkip) + '\n';
+            return true;
+        });
+
+        // The header tells what was indexed, that is known not before now
+        if (index.isOpen()) {
+            index.write(pageIndexHeader(setup.maxChar, setup.maxLines, job.txtFile, source.bytesRead()));
+            index.write(pageLines);
+        }
+        source.close();
+
+        // Let's break another rule! This way looks the code nicer
+        if (jobs.size() > 1) qStdOut() << pages << '\t' << job.txtFile << Qt::endl;
+        else                 qStdOut() << pages << Qt::endl;
+    }
+
+    if (index.isOpen() and ! index.flush()) {
+        qStdErr() << "Can't write page index: " << index.fileName() << Qt::endl;
+        result = 1;
+    }
+
+    return result;
+}
+
+// Do what the options say, the real main()
+static int runCommand(const QCommandLineParser &parser, Session *session)
+{
     //
     // Let's get ready to rumble!
     // Show any kind of help first before we need to dig deeper
@@ -105,8 +338,8 @@ int main(int argc, char *argv[])
         // moreHelpOption.setDescription("You read it NOW"); // FIXME Don't work!(?)
 
         // May better, but so many warnings: https://doc.qt.io/qt-5/qcoreapplication.html#arguments
-        // const QString me = app.arguments().at(0);
-        const QString me = app.applicationName();
+        // const QString me = app->arguments().at(0);
+        const QString me = QCoreApplication::applicationName();
         qStdOut() <<  "This is " MY_NAME " v" MY_VERSION << Qt::endl
                   << "Create a PDF out of a plain text file" << Qt::endl
                   << Qt::endl
@@ -134,6 +367,36 @@ int main(int argc, char *argv[])
                   << "Furthermore is there no special font-style requested but both ways shown how to" << Qt::endl
                   << "give a foundry (Cronyx in this case)" << Qt::endl
                   << Qt::endl
+                  << "  Convert many files in one go, each PDF is placed beside its text file" << Qt::endl
+                  << "      " << me << " --batch *.log" << Qt::endl
+                  << "      find . -name '*.txt' | " << me << " --manifest - --jobs 0" << Qt::endl
+                  << Qt::endl
+                  << "  Keep a server running and let it do the jobs, font and page stay resolved" << Qt::endl
+                  << "      " << me << " --serve " << me << ".sock &" << Qt::endl
+                  << "      dmesg | " << me << " --client " << me << ".sock /tmp/dmesg" << Qt::endl
+                  << Qt::endl
+                  << "  Keep the PDF of a growing log file up to date, e.g. by cron" << Qt::endl
+                  << "      " << me << " -b native --update /var/log/foo.pdf /var/log/foo.log" << Qt::endl
+                  << Qt::endl
+                  << "  Archive a huge log, as small as we can, with all cores" << Qt::endl
+                  << "      " << me << " -b native -z 9 --object-streams -j 0 foo.pdf foo.log" << Qt::endl
+                  << Qt::endl
+                  << "  Only some pages of a huge log, the index makes the jump even faster" << Qt::endl
+                  << "      " << me << " --page-index foo.idx -c foo.log" << Qt::endl
+                  << "      " << me << " --pages 4000-4010 --page-index foo.idx part.pdf foo.log" << Qt::endl
+                  << Qt::endl
+                  << "  Split a huge log into volumes of 1000 pages, done by all cores" << Qt::endl
+                  << "      " << me << " --split 1000 -j 0 -i huge.log" << Qt::endl
+                  << Qt::endl
+                  << "  Nightly job, only changed files are converted again" << Qt::endl
+                  << "      " << me << " --cache --batch /var/log/archive/*.log" << Qt::endl
+                  << Qt::endl
+                  << "  Refuse too big jobs before they cost anything" << Qt::endl
+                  << "      test $(" << me << " -c foo.log) -le 500 && " << me << " -i foo.log" << Qt::endl
+                  << Qt::endl
+                  << "  Stream the PDF to stdout, no temporary file needed" << Qt::endl
+                  << "      journalctl -b | " << me << " - | ssh archive 'cat > boot.pdf'" << Qt::endl
+                  << Qt::endl
                   << "Miscellaneous:" << Qt::endl
                   << "  - The hard coded default paper is A4" << Qt::endl
                   << "  - The hard coded default font is Hack in size 10Points" << Qt::endl
@@ -143,17 +406,66 @@ int main(int argc, char *argv[])
                   // e.g. "Monospace" and "Noto Sans SignWriting"
                   << "    calculations of maximum rows and cols" << Qt::endl
                   << "  - The key given by --page-size must match exactly but is case insensitive" << Qt::endl
+                  << "  - The native backend write the PDF without QPdfWriter, which is much faster." << Qt::endl
+                  << "    But only TrueType fonts can be embedded and there is no fallback font for" << Qt::endl
+                  << "    chars missing in the font, those are shown as box" << Qt::endl
+                  << "  - --compression 0 is the fastest way but gives huge files, 1 is nearly as fast" << Qt::endl
+                  << "    and not much bigger than 9. With --jobs are the pages compressed in parallel" << Qt::endl
+                  << "  - With - as [pdf-to-create] is the PDF written to stdout, page by page as" << Qt::endl
+                  << "    soon as they are done. Like with -i is there no override check" << Qt::endl
+                  << "  - --stats shows the time of each phase. Read, layout and print go hand in" << Qt::endl
+                  << "    hand line by line, their times are summed up. With --jobs are the times" << Qt::endl
+                  << "    of all threads added up" << Qt::endl
+                  << "  - --count-pages wraps the lines like the conversion would do, but only counts" << Qt::endl
+                  << "    rows. With --page-index is the line, its byte offset and the rows of the" << Qt::endl
+                  << "    line on the page before noted for each page. Lines and pages count from 1." << Qt::endl
+                  << "    The index is only written for a text file, not for stdin" << Qt::endl
+                  << "  - --pages needs a text file, no stdin. Without --page-index, or when the" << Qt::endl
+                  << "    index don't fit to the settings or the text was edited, is the text before" << Qt::endl
+                  << "    counted like by -c" << Qt::endl
+                  << "  - --split writes one volume after the other, the memory use don't grow. With" << Qt::endl
+                  << "    --jobs and a text file are volumes of N pages done in parallel. A volume" << Qt::endl
+                  << "    of N megabytes ends with the first page after that size, so it's a bit more." << Qt::endl
+                  << "    Existing volumes are only replaced by --force, and those of an earlier run" << Qt::endl
+                  << "    with a higher number than now made are removed" << Qt::endl
+                  << "  - --cache notes the hash of text and settings of each PDF in the user cache" << Qt::endl
+                  << "    directory. A PDF which was touched since is made again. Text from stdin," << Qt::endl
+                  << "    PDF to stdout, --update and --split are never cached" << Qt::endl
+                  << "  - --update keeps its notes in <pdf-to-create>.state. The last page is done" << Qt::endl
+                  << "    again and new pages are appended by an incremental update of the PDF." << Qt::endl
+                  << "    When the text of the last page was changed, or the text got shorter, or the" << Qt::endl
+                  << "    settings differ, the PDF is created from scratch. The text before the last" << Qt::endl
+                  << "    page is not checked, to keep it fast, so after an edit there delete the" << Qt::endl
+                  << "    .state file. But a PDF which is not the one of the .state file, or has" << Qt::endl
+                  << "    none, is only replaced by --force" << Qt::endl
+                  << "  - Tabs are replaced by spaces up to the next multiple of 8 columns" << Qt::endl
+                  << "  - Long lines are cut at the last column and continued in the next row" << Qt::endl
+                  << "  - With --batch or --manifest are all arguments taken as [text-file], font and" << Qt::endl
+                  << "    page are only once resolved for all files. A failed file don't stop the batch" << Qt::endl
+                  << "  - With --client are all other options and stdin passed to the server, paths" << Qt::endl
+                  << "    are taken relative to the current directory of the client" << Qt::endl
                   ;
         return 0;
     }
 
     // ...and normal help if no BIG help was requested
     if (parser.isSet("h")) {
-      parser.showHelp(0);
+        qStdOut() << parser.helpText();
+        return 0;
     }
 
     // Font listing is another kind of help...
+    // Walking the font database is slow, so the listing is cached too
+    FontCache *fontCache = parser.isSet("no-font-cache") ? nullptr : session->fontCache.get();
+
     if (parser.isSet("list-fonts")) {
+        QString fontList;
+        if (fontCache and fontCache->fontList(&fontList)) {
+            qStdOut() << fontList;
+            return 0;
+        }
+
+        QTextStream out(&fontList);
         const QStringList fontFamilies = QFontDatabase::families();
         for (const QString &family : fontFamilies) {
 
@@ -161,7 +473,7 @@ int main(int argc, char *argv[])
             if (! QFontDatabase::isFixedPitch(family)) continue;  // For my taste should we only use fixed fonts
             if (! QFontDatabase::isScalable(family)) continue;    // Um, "Terminus" e.g. don't work, will use: lines=423 columns=599
 
-            qStdOut() << family << Qt::endl;
+            out << family << Qt::endl;
 
             const QStringList fontStyles = QFontDatabase::styles(family);
             for (const QString &style : fontStyles) {
@@ -172,29 +484,23 @@ int main(int argc, char *argv[])
                 for (int points : pointSizes)
                     sizes += QString::number(points) + ' ';
 
-                qStdOut() << "  " << style << " : " << sizes.trimmed() << Qt::endl;
+                out << "  " << style << " : " << sizes.trimmed() << Qt::endl;
             }
         }
+        out.flush();
+
+        if (fontCache) fontCache->setFontList(fontList);
+        qStdOut() << fontList;
         return 0;
     }
 
     // Some needed var
     QString pdfFile;
     QString txtFile;
-    QString txtFileName;
-    QString fontFamily = MY_FONTFAMILY;
-    QString fontStyle;
-    int fontSize = MY_FONTSIZE;
-    const qreal defautMargin = 5.0;
-    QPageSize pageSize = QPageSize(QPageSize::A4);
-    QPageLayout::Orientation pageOrientation = QPageLayout::Portrait;
-    QList<qreal> marginList;
-    enum MarginType {
-        LeftMargin,
-        RightMargin,
-        TopMargin,
-        BottomMargin
-    };
+    bool explicitPdf = false;   // Not made up by pdfNameOf()
+    bool batchFailed = false;   // Some entry was bad, but the others are done
+    QList<ConvertJob> jobs;
+    PageSetup wanted;
 
     // ...just as paper listing
     if (parser.isSet("list-mo-keys")) {
@@ -222,71 +528,81 @@ int main(int argc, char *argv[])
     // We start with page and font settings...
     //
 
-    if (parser.isSet("page-size")) {
-        const QString match = parser.value("page-size");
-        for (int id = 0; ; ++id) {
-            const QString key = QPageSize::key(static_cast<QPageSize::PageSizeId>(id));
-
-            if (key.isEmpty()) {
-                qStdErr() << "Key not found: " << match << Qt::endl;
-                return 1;
-            }
-            if (key.compare(match, Qt::CaseInsensitive)) continue;
-            pageSize= QPageSize(static_cast<QPageSize::PageSizeId>(id));
-            break;
-        }
+    if (parser.isSet("page-size") and ! wanted.parsePageSize(parser.value("page-size"))) {
+        qStdErr() << "Key not found: " << parser.value("page-size") << Qt::endl;
+        return 1;
     }
 
     if (parser.isSet("landscape")) {
-        pageOrientation = QPageLayout::Landscape;
-    }
-
-    // Examine font setting
-    if (parser.isSet("font")) {
-        fontFamily.clear();
-        int tmpFontSize = 0;
-        bool isNumber = true;
-        const QStringList fontParts = parser.value("font").split(",");
-        // Try to be user friendly, accept options given as...
-        // 10 // Mono // Mono,10 // Mono,Bold // Mono,Bold,10 // Mono,10,Bold
-        // We catch many bad settings, like no numbers as font/style or to much args
-        for (const QString &part : fontParts) {
-            if (part.toUInt(&isNumber) and ! tmpFontSize) {
-                tmpFontSize = part.toUInt();
-                continue;
-            }
-            if (fontFamily.isEmpty() and !isNumber) {
-                fontFamily = part.trimmed();
-                continue;
-            }
-            if (fontStyle.isEmpty() and !isNumber) {
-                fontStyle = part.trimmed();
-                continue;
-            }
-            qStdErr() << "Too much set: " << parser.value("font") << Qt::endl;
-            return 1;
-        }
+        wanted.pageOrientation = QPageLayout::Landscape;
+    }
 
-        (tmpFontSize) ? fontSize = tmpFontSize : fontSize = MY_FONTSIZE;
-        if (fontFamily.isEmpty()) fontFamily = MY_FONTFAMILY;
+    if (parser.isSet("font") and ! wanted.parseFont(parser.value("font"))) {
+        qStdErr() << "Too much set: " << parser.value("font") << Qt::endl;
+        return 1;
     }
 
-    const QStringList marginStrList = parser.value("margins").split(",");
-    for (const auto &marginVal : marginStrList) {
-        qreal margin;
-        if (marginVal.isEmpty()) {
-            margin = defautMargin;
-        } else {
-            bool ok = true;
-            margin = marginVal.toDouble(&ok);
-            if (! ok) {
-                qStdErr() << "Bad margin value: " << marginVal << Qt::endl;
-                return 1;
-            }
+    if (! wanted.parseMargins(parser.value("margins"))) {
+        qStdErr() << "Bad margin value: " << parser.value("margins") << Qt::endl;
+        return 1;
+    }
+
+    if (! wanted.parseBackend(parser.value("backend"))) {
+        qStdErr() << "Unknown backend: " << parser.value("backend") << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet("update") and wanted.backend != PageSetup::NativeBackend) {
+        qStdErr() << "Update works only with --backend native" << Qt::endl;
+        return 1;
+    }
+    if ((parser.isSet("compression") or parser.isSet("object-streams")) and wanted.backend != PageSetup::NativeBackend) {
+        qStdErr() << "Compression and object streams work only with --backend native" << Qt::endl;
+        return 1;
+    }
+
+    if (! wanted.parseCompression(parser.value("compression"))) {
+        qStdErr() << "Bad compression level: " << parser.value("compression") << Qt::endl;
+        return 1;
+    }
+    wanted.objectStreams = parser.isSet("object-streams");
+
+    bool isNumber = true;
+    int firstPage = 0;
+    int lastPage = 0;
+    if (parser.isSet("pages") and ! parsePageRange(parser.value("pages"), &firstPage, &lastPage)) {
+        qStdErr() << "Bad page range: " << parser.value("pages") << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet("pages") and parser.isSet("update")) {
+        qStdErr() << "Update can't be done with --pages" << Qt::endl;
+        return 1;
+    }
+
+    int volumePages = 0;
+    qint64 volumeBytes = 0;
+    if (parser.isSet("split")) {
+        QString split = parser.value("split");
+        const bool megabytes = split.endsWith('M', Qt::CaseInsensitive);
+        if (megabytes) split.chop(1);
+        const int value = split.toInt(&isNumber);
+        if (! isNumber or value < 1) {
+            qStdErr() << "Bad split value: " << parser.value("split") << Qt::endl;
+            return 1;
         }
-        marginList << margin;
+        if (megabytes) volumeBytes = value * qint64(1024 * 1024);
+        else           volumePages = value;
+    }
+    if (parser.isSet("split") and (parser.isSet("update") or parser.isSet("pages"))) {
+        qStdErr() << "Split can't be done with --update or --pages" << Qt::endl;
+        return 1;
+    }
+
+    int threads = parser.value("jobs").toInt(&isNumber);
+    if (! isNumber or threads < 0) {
+        qStdErr() << "Bad number of jobs: " << parser.value("jobs") << Qt::endl;
+        return 1;
     }
-    while (marginList.size() < 4) marginList << defautMargin;
+    if (threads == 0) threads = QThread::idealThreadCount();
 
     //
     // ...and continue to determine in/out files
@@ -307,6 +623,26 @@ int main(int argc, char *argv[])
         goto ApplySettings;
     }
 
+    if (countsOnly(parser)) {
+        // No PDF is created, so all arguments are text files, and none is stdin
+        if (parser.isSet("in-file") or ! args.isEmpty() or parser.isSet("manifest")) {
+            if (! collectBatchJobs(parser, session->input, &jobs, &batchFailed)) return 1;
+            txtFile = QString("[%1 files]").arg(jobs.size());
+        } else {
+            jobs << ConvertJob{QString(), QString(), session->input};
+        }
+        pdfFile = "[none]";
+        goto ApplySettings;
+    }
+
+    if (parser.isSet("batch") or parser.isSet("manifest")) {
+        // Once more the taboo, batch jobs have their own rules
+        if (! collectBatchJobs(parser, session->input, &jobs, &batchFailed)) return 1;
+        txtFile = QString("[%1 files]").arg(jobs.size());
+        pdfFile = "[beside each text file]";
+        goto ApplySettings;
+    }
+
     if (parser.isSet("in-file")) {
         txtFile = parser.value("in-file");
         QFileInfo info(txtFile);
@@ -315,28 +651,25 @@ int main(int argc, char *argv[])
             return 1;
         }
         txtFile = info.canonicalFilePath();
-        txtFileName = info.fileName();
         neededArguments = 0;
-        pdfFile = info.canonicalPath() + "/" + info.completeBaseName() + ".pdf";
+        pdfFile = pdfNameOf(info);
     }
 
     if (args.size() < neededArguments) {
-        parser.showHelp(1);
+        qStdOut() << parser.helpText();
+        return 1;
     }
 
-    if (args.size() > 0) {
-        pdfFile = args.at(0);
-        QFileInfo info(pdfFile);
-        if (! pdfFile.endsWith(".pdf")) {
-            pdfFile = info.absolutePath() + "/" + info.completeBaseName() + ".pdf";
-        }
+    if (args.size() > 0 and args.at(0) == "-") {
+        // Stream to stdout, so there is nothing to override
+        pdfFile = "-";
+    } else if (args.size() > 0) {
+        pdfFile = pdfNameFrom(args.at(0));
 
-        // Validate out file, yeah only if not implicit set by -i
-        if (QFile::exists(pdfFile) and ! parser.isSet("force")) {
-            qStdErr() << "File already exist: " << pdfFile << Qt::endl
-                      << "Use --force if you don't care" << Qt::endl;
-            return 1;
-        }
+        // Validate out file, yeah only if not implicit set by -i. That's done by
+        // the Converter, the cache may have it already and an update knows if
+        // it's our PDF
+        explicitPdf = true;
     }
 
     if (txtFile.isEmpty() and args.size() == 2) {
@@ -347,9 +680,22 @@ int main(int argc, char *argv[])
             return 1;
         }
         txtFile = info.canonicalFilePath();
-        txtFileName = info.fileName();
     }
 
+    if (parser.isSet("split") and pdfFile == "-") {
+        qStdErr() << "Can't split to stdout" << Qt::endl;
+        return 1;
+    }
+
+    if (parser.isSet("update") and (txtFile.isEmpty() or pdfFile == "-")) {
+        qStdErr() << "Update needs a text file and a PDF file, no stdin/stdout" << Qt::endl;
+        return 1;
+    }
+
+    jobs << ConvertJob{txtFile, pdfFile, session->input, (pdfFile == "-") ? session->output : nullptr, parser.isSet("update")};
+    // An update may continue its own PDF, but not replace a foreign one
+    jobs.last().overwrite = parser.isSet("force") or (! explicitPdf and ! parser.isSet("update"));
+
     //
     // We are close to finish, time to apply settings and poll the feedback
     // so we can calculate most important data: maxChar and maxLines
@@ -357,48 +703,43 @@ int main(int argc, char *argv[])
 
 ApplySettings: // Nasty goto label :-)
 
-    QPrinter printer(QPrinter::HighResolution);
-    if (! txtFileName.isEmpty()) printer.setDocName(txtFileName);
-    printer.setCreator(app.applicationName() + " v" + app.applicationVersion());
-    printer.setOutputFileName(pdfFile);
-    printer.setOutputFormat(QPrinter::PdfFormat);
-    printer.setPageSize(pageSize);
-    printer.setPageOrientation(pageOrientation);
-    // printer.setFullPage(true); // NO! We want our margins
-
-    printer.setPageMargins(QMarginsF(mmToPoints(marginList.at(LeftMargin))
-                                   , mmToPoints(marginList.at(TopMargin))
-                                   , mmToPoints(marginList.at(RightMargin))
-                                   , mmToPoints(marginList.at(BottomMargin))));
-
-    QFont font(QFont(fontFamily, fontSize), &printer);
-    font.setStyleName(fontStyle);
-
-    QFontMetricsF fm(font);
-    // qMax(0, ...) to avoid negative values when user makes strange settings
-    // Which char-width is "best/correct" I don't know, this one has worked in a couple of tests..
-    int maxChar = qMax(0.0, printer.width() / fm.horizontalAdvance('X'));
-    // ..while these fm.averageCharWidth() fm.maxWidth() sometimes differ, sometimes not, strange
-    int maxLines = qMax(0.0, printer.height() / fm.height());
+    for (ConvertJob &job : jobs) {
+        job.firstPage = firstPage;
+        job.lastPage = lastPage;
+        job.pageIndex = parser.value("page-index");
+        job.volumePages = volumePages;
+        job.volumeBytes = volumeBytes;
+    }
+
+    // Here is the time consuming part, only done once even in batch mode and
+    // not at all when the font is known by the cache or the server had it before
+    session->stats.enter(Stats::Resolve);
+    const PageSetup &setup = resolvedSetup(wanted, fontCache, session);
+    session->stats.stop();
+
+    const QFont &font = setup.font;
+    const int maxChar = setup.maxChar;
+    const int maxLines = setup.maxLines;
 
     if (parser.isSet("info") or parser.isSet("test-page")) {
-        QFontInfo fi(font);
-        qStdOut() << "Requested Font   : " << fontFamily << Qt::endl
-                  << "Req Font Style   : " << fontStyle << Qt::endl
-                  << "Req Font Size    : " << fontSize << Qt::endl
-                  << "Used Font        : " << fi.family() << Qt::endl
-                  << "Used Style       : " << fi.styleName() << Qt::endl
-                  << "Used Size        : " << fi.pointSize() << Qt::endl
-                  << "Has Fixed Pitch  : " << ((fi.fixedPitch()) ? "yes" : "NO") << Qt::endl
-                  << "Page Size        : " << pageSize.name() << Qt::endl
-                  << "Page Orientation : " << ((pageOrientation) ? "Landscape" : "Portrait") << Qt::endl
+        qStdOut() << "Requested Font   : " << wanted.fontFamily << Qt::endl
+                  << "Req Font Style   : " << wanted.fontStyle << Qt::endl
+                  << "Req Font Size    : " << wanted.fontSize << Qt::endl
+                  << "Used Font        : " << setup.usedFamily << Qt::endl
+                  << "Used Style       : " << setup.usedStyle << Qt::endl
+                  << "Used Size        : " << setup.usedPointSize << Qt::endl
+                  << "Has Fixed Pitch  : " << ((setup.fixedPitch) ? "yes" : "NO") << Qt::endl
+                  << "Page Size        : " << wanted.pageSize.name() << Qt::endl
+                  << "Page Orientation : " << ((wanted.pageOrientation) ? "Landscape" : "Portrait") << Qt::endl
+                  << "Backend          : " << parser.value("backend") << Qt::endl
+                  << "Compression      : " << ((wanted.backend == PageSetup::NativeBackend) ? QString::number(wanted.compression) : "by Qt") << Qt::endl
                   << "Max Lines        : " << maxLines << Qt::endl
                   << "Max Columns      : " << maxChar << Qt::endl
                   ;
         // Let's break another rule! This way looks the code nicer
         if (parser.isSet("info")) {
         qStdOut() << "In-File          : " << ((txtFile.isEmpty()) ? "<stdin>" : txtFile) << Qt::endl
-                  << "Out-File         : " << pdfFile << Qt::endl; return 0; }
+                  << "Out-File         : " << ((pdfFile == "-") ? "<stdout>" : pdfFile) << Qt::endl; return 0; }
     }
 
     if (maxChar < 1 or maxLines < 1) {
@@ -406,7 +747,15 @@ ApplySettings: // Nasty goto label :-)
             return 1;
     }
 
-    // To collect the in-file
+    // Before any PDF is opened, which would be left empty or, by -i, destroyed
+    if (setup.backend == PageSetup::NativeBackend and ! countsOnly(parser) and ! PdfRenderer::supports(font)) {
+        qStdErr() << "Font not supported by native backend, only TrueType: " << setup.usedFamily << Qt::endl;
+        return 1;
+    }
+
+    if (countsOnly(parser)) return (runCountPages(parser, jobs, setup) or batchFailed) ? 1 : 0;
+
+    // To collect the test page, any other input is streamed to the renderer
     QStringList content;
 
     if (parser.isSet("test-page")) {
@@ -510,37 +859,236 @@ PrintLineNumbers: // Once again nasty goto label
 
         // Well, we are slightly hasty with this statement. I guess Murphy is already grinning...
         qStdOut() << "Test page written to: " << pdfFile << Qt::endl;
+    }
 
+    // Here is the beef! Create the PDF(s)
+    const bool wantStats = parser.isSet("stats") or parser.isSet("stats-json");
+    Stats *stats = wantStats ? &session->stats : nullptr;
+    const qint64 allocations = Stats::allocationCount();
+    bool success = ! batchFailed;
 
-    } else if (txtFile.isEmpty() and args.size() == 1) {
-        QTextStream in(stdin);
-        while(!in.atEnd()) {
-            QString line = in.readLine();
-            content.append(line);
+    if (parser.isSet("test-page")) {
+        Converter converter(setup);
+        converter.setStats(stats);
+        success = converter.convert(content, pdfFile);
+        if (success) {
+            session->pdfFiles << pdfFile;
+        } else {
+            qStdErr() << converter.errorString() << Qt::endl;
         }
     } else {
-        QFile file(txtFile);
-        if(!file.open(QIODevice::ReadOnly)) {
-            qStdErr() << file.errorString() << Qt::endl;
-            return 1;
+        // Volumes of a text file don't need each other, so they can be done in
+        // parallel. Otherwise they are streamed out one after the other
+        std::vector<QStringList> volumes(jobs.size());
+        if (volumePages > 0 and threads > 1) {
+            QList<ConvertJob> volumeJobs;
+            for (const ConvertJob &job : std::as_const(jobs)) {
+                QString error;
+                if (job.txtFile.isEmpty()) {
+                    volumeJobs << job;
+                } else if (! splitJob(setup, job, &volumeJobs, &error)) {
+                    qStdErr() << error << Qt::endl;
+                    success = false;
+                }
+            }
+            jobs = volumeJobs;
+            volumes.resize(jobs.size());
+        }
+        for (qsizetype i = 0; i < jobs.size(); ++i) {
+            if (jobs.at(i).volumePages > 0 or jobs.at(i).volumeBytes > 0) jobs[i].volumes = &volumes[i];
+        }
+
+        std::unique_ptr<ResultCache> resultCache;
+        if (parser.isSet("cache") or parser.isSet("cache-dir")) {
+            resultCache = std::make_unique<ResultCache>(parser.value("cache-dir"));
+        }
+
+        // Don't let a bad file stop the batch, but let the caller know
+        const bool converted = convertJobs(setup, jobs, threads, [](const QString &error) {
+            qStdErr() << error << Qt::endl;
+        }, stats, resultCache.get());
+        success = success and converted;
+
+        if (converted) {
+            for (qsizetype i = 0; i < jobs.size(); ++i) {
+                session->pdfFiles << (jobs.at(i).volumes ? volumes.at(i) : QStringList(jobs.at(i).pdfFile));
+            }
         }
+    }
 
-        QTextStream in(&file);
-        while(!in.atEnd()) {
-            QString line = in.readLine();
-            content.append(line);
+    // Always to stderr, stdout may be busy with the PDF
+    if (wantStats) {
+        if (allocations >= 0) session->stats.allocations = Stats::allocationCount() - allocations;
+        if (parser.isSet("stats-json")) {
+            qStdErr() << session->stats.toJson() << Qt::endl;
+        } else {
+            qStdErr() << session->stats.toText();
         }
+    }
+
+    return success ? 0 : 1;
+}
+
+// Let the command run as if it was started in the working dir of the client,
+// but with the warm font and page settings of the server
+static ServerReply runRequest(const ServerRequest &request, Session *session)
+{
+    session->stats = Stats();
+    session->stats.enter(Stats::Parse);
 
-        file.close();
+    ServerReply reply;
+    QTextStream out(&reply.out);
+    QTextStream err(&reply.err);
+    s_requestOut = &out;
+    s_requestErr = &err;
+
+    // A PDF to stdout goes back to the client
+    QBuffer pdfBuffer(&reply.pdf);
+    pdfBuffer.open(QIODevice::WriteOnly);
+
+    session->input = &request.input;
+    session->output = &pdfBuffer;
+    session->pdfFiles.clear();
+
+    QCommandLineParser parser;
+    addOptions(&parser);
+
+    if (! QDir::setCurrent(request.workDir)) {
+        err << "Working directory not accessible: " << request.workDir << Qt::endl;
+    } else if (! parser.parse(QStringList(QCoreApplication::applicationName()) + request.arguments)) {
+        err << parser.errorText() << Qt::endl;
+    } else if (parser.isSet("serve") or parser.isSet("client")) {
+        err << "Can't use --serve or --client in a server job" << Qt::endl;
+    } else if (parser.isSet("version")) {
+        out << MY_NAME " " MY_VERSION << Qt::endl;
+        reply.exitCode = 0;
+    } else {
+        reply.exitCode = runCommand(parser, session);
+    }
+
+    out.flush();
+    err.flush();
+    s_requestOut = nullptr;
+    s_requestErr = nullptr;
+    reply.pdfFiles = session->pdfFiles;
+    session->input = nullptr;
+    session->output = nullptr;
+
+    return reply;
+}
+
+// Only a plain conversion without text file takes stdin, or a manifest named -
+static bool readsStdin(const QCommandLineParser &parser)
+{
+    if (parser.value("manifest") == "-") return true;
+    if (countsOnly(parser)) {
+        return parser.positionalArguments().isEmpty() and ! parser.isSet("in-file") and ! parser.isSet("manifest");
+    }
+
+    for (const char *name : {"help", "h", "version", "list-fonts", "list-mo-keys", "info", "test-page", "batch", "manifest", "in-file"}) {
+        if (parser.isSet(name)) return false;
+    }
+
+    return parser.positionalArguments().size() < 2;
+}
+
+static int runClient(const QCommandLineParser &parser, const QStringList &arguments)
+{
+    ServerRequest request;
+    request.workDir = QDir::currentPath();
+
+    // All but our own option and the program name is for the server
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &arg = arguments.at(i);
+        if (arg == "--client") {
+            ++i;
+            continue;
+        }
+        if (arg.startsWith("--client=")) continue;
+        request.arguments << arg;
+    }
+
+    if (readsStdin(parser)) {
+        QFile in;
+        in.open(stdin, QIODevice::ReadOnly);
+        request.input = in.readAll();
+    }
+
+    ServerReply reply;
+    QString errorString;
+    if (! sendRequest(parser.value("client"), request, &reply, &errorString)) {
+        qStdErr() << errorString << Qt::endl;
+        return 1;
+    }
+
+    qStdOut() << reply.out;
+    if (! reply.pdf.isEmpty()) {
+        qStdOut().flush();
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        out.write(reply.pdf);
+    }
+    qStdErr() << reply.err;
+
+    return reply.exitCode;
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef WRT2PDF_COUNT_ALLOCATIONS
+    Stats::setAllocationCounter(mallocCount);
+#endif
+    Session session;
+    session.stats.enter(Stats::Parse);
+
+    QCoreApplication::setApplicationName(MY_NAME);
+    QCoreApplication::setApplicationVersion(MY_VERSION);
+
+    QCommandLineParser parser;
+    addOptions(&parser);
+
+    // A first look, without any application, to know which kind we need. Only
+    // when fonts come into play we need QGuiApplication. But we never show
+    // anything, so the offscreen platform will do. It needs no display and
+    // loads fast, unless the user know better
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) arguments << QString::fromLocal8Bit(argv[i]);
+    parser.parse(arguments);
+
+    const bool needFonts = ! (parser.isSet("help") or parser.isSet("h") or parser.isSet("version") or parser.isSet("client")
+                              or (parser.isSet("list-mo-keys") and ! parser.isSet("list-fonts")));
+
+    std::unique_ptr<QCoreApplication> app;
+    if (needFonts) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+        app = std::make_unique<QGuiApplication>(argc, argv);
+    } else {
+        app = std::make_unique<QCoreApplication>(argc, argv);
+    }
+
+    // Process the actual command line arguments given by the user
+    parser.process(*app);
+
+    // The client only pass the job, the server does it
+    if (parser.isSet("client")) {
+        return runClient(parser, arguments);
+    }
+
+    session.fontCache = std::make_unique<FontCache>();
+
+    if (parser.isSet("serve")) {
+        Server server([&session](const ServerRequest &request) {
+            return runRequest(request, &session);
+        });
+        if (! server.listen(parser.value("serve"))) {
+            qStdErr() << "Can't listen on " << parser.value("serve") << ": " << server.errorString() << Qt::endl;
+            return 1;
+        }
+        qStdOut() << "Listen on: " << server.serverName() << Qt::endl;
+        return app->exec();
     }
 
-    // Here is the beef! Create the PDF
-    QTextDocument doc;
-    doc.setDefaultFont(font);
-    doc.setDocumentMargin(0.0);
-    doc.setPageSize(QSizeF(printer.pageRect(QPrinter::DevicePixel).size()));
-    doc.setPlainText(content.join("\n"));
-    doc.print(&printer);
+    return runCommand(parser, &session);
 }
 
 // That's all folks!
@@ -0,0 +1,195 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "pagesetup.h"
+#include "fontcache.h"
+
+#include <QCoreApplication>
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QImage>
+#include <QPdfWriter>
+
+inline qreal mmToPoints(const qreal& mm) {
+    return (mm * 72/25.4);
+}
+
+// The font need to know the resolution to calculate right, but there is no
+// way to tell it except by some paint device. A tiny image is the cheapest one
+static QImage dpiDevice(int dpi)
+{
+    QImage device(1, 1, QImage::Format_Mono);
+    const int dotsPerMeter = qRound(dpi / 0.0254);
+    device.setDotsPerMeterX(dotsPerMeter);
+    device.setDotsPerMeterY(dotsPerMeter);
+
+    return device;
+}
+
+void PageSetup::resolve(FontCache *cache)
+{
+    // No QPrinter or QPdfWriter needed, which would cost more than all the rest
+    resolution = Resolution;
+    const QImage device = dpiDevice(resolution);
+    const QRect printArea = pageLayout().paintRectPixels(resolution);
+
+    // Cheap, the font is not matched until someone ask for details
+    font = QFont(QFont(fontFamily, fontSize), &device);
+    font.setStyleName(fontStyle);
+
+    FontMetrics metrics;
+    const QString key = FontCache::key(fontFamily, fontStyle, fontSize, resolution);
+    if (! cache or ! cache->lookup(key, &metrics)) {
+        QFontMetricsF fm(font);
+        QFontInfo fi(font);
+        metrics.family = fi.family();
+        metrics.styleName = fi.styleName();
+        metrics.pointSize = fi.pointSize();
+        metrics.fixedPitch = fi.fixedPitch();
+        // Which char-width is "best/correct" I don't know, this one has worked in a couple of tests..
+        metrics.advance = fm.horizontalAdvance('X');
+        // ..while these fm.averageCharWidth() fm.maxWidth() sometimes differ, sometimes not, strange
+        metrics.height = fm.height();
+        metrics.ascent = fm.ascent();
+        if (cache) cache->insert(key, metrics);
+    }
+
+    usedFamily = metrics.family;
+    usedStyle = metrics.styleName;
+    usedPointSize = metrics.pointSize;
+    fixedPitch = metrics.fixedPitch;
+
+    // qMax(0, ...) to avoid negative values when user makes strange settings
+    maxChar = qMax(0.0, printArea.width() / metrics.advance);
+    maxLines = qMax(0.0, printArea.height() / metrics.height);
+
+    lineHeight = metrics.height * 72.0 / resolution;
+    ascent = metrics.ascent * 72.0 / resolution;
+}
+
+bool PageSetup::parseFont(const QString &desc)
+{
+    QString family;
+    QString style;
+    int size = 0;
+    bool isNumber = true;
+    // Try to be user friendly, accept options given as...
+    // 10 // Mono // Mono,10 // Mono,Bold // Mono,Bold,10 // Mono,10,Bold
+    // We catch many bad settings, like no numbers as font/style or to much args
+    for (const QString &part : desc.split(",")) {
+        if (part.toUInt(&isNumber) and ! size) {
+            size = part.toUInt();
+            continue;
+        }
+        if (family.isEmpty() and !isNumber) {
+            family = part.trimmed();
+            continue;
+        }
+        if (style.isEmpty() and !isNumber) {
+            style = part.trimmed();
+            continue;
+        }
+        return false;
+    }
+
+    fontFamily = family.isEmpty() ? DefaultFontFamily : family;
+    fontStyle = style;
+    fontSize = size ? size : DefaultFontSize;
+
+    return true;
+}
+
+bool PageSetup::parsePageSize(const QString &key)
+{
+    for (int id = 0; ; ++id) {
+        const QString idKey = QPageSize::key(static_cast<QPageSize::PageSizeId>(id));
+        if (idKey.isEmpty()) return false;
+        if (idKey.compare(key, Qt::CaseInsensitive)) continue;
+        pageSize = QPageSize(static_cast<QPageSize::PageSizeId>(id));
+        return true;
+    }
+}
+
+bool PageSetup::parseMargins(const QString &list)
+{
+    QList<qreal> values;
+    for (const QString &value : list.split(",")) {
+        bool ok = true;
+        values << (value.isEmpty() ? DefaultMargin : value.toDouble(&ok));
+        if (! ok) return false;
+    }
+    while (values.size() < 4) values << DefaultMargin;
+
+    // Given as left, right, top, bottom but QMarginsF want left, top...
+    margins = QMarginsF(values.at(0), values.at(2), values.at(1), values.at(3));
+
+    return true;
+}
+
+bool PageSetup::parseBackend(const QString &name)
+{
+    if (name == "native") {
+        backend = NativeBackend;
+    } else if (name == "qt") {
+        backend = QtBackend;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool PageSetup::parseCompression(const QString &level)
+{
+    bool isNumber = true;
+    const int value = level.toInt(&isNumber);
+    if (! isNumber or value < 0 or value > 9) return false;
+
+    compression = value;
+    return true;
+}
+
+void PageSetup::applyTo(QPdfWriter *writer) const
+{
+    writer->setCreator(QCoreApplication::applicationName() + " v" + QCoreApplication::applicationVersion());
+    writer->setResolution(resolution);
+    writer->setPageLayout(pageLayout());
+}
+
+QPageLayout PageSetup::pageLayout() const
+{
+    // Yes, the points are given as millimeter, that's how it was always done
+    return QPageLayout(pageSize, pageOrientation
+                     , QMarginsF(mmToPoints(margins.left())
+                               , mmToPoints(margins.top())
+                               , mmToPoints(margins.right())
+                               , mmToPoints(margins.bottom()))
+                     , QPageLayout::Millimeter);
+}
+
+QFont independentFont(const QString &fontDesc, int dpi)
+{
+    const QImage device = dpiDevice(dpi);
+    QFont font;
+    font.fromString(fontDesc);
+
+    return QFont(font, &device);
+}
@@ -0,0 +1,97 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef PAGESETUP_H
+#define PAGESETUP_H
+
+#include <QFont>
+#include <QMarginsF>
+#include <QPageLayout>
+#include <QPageSize>
+#include <QString>
+
+class FontCache;
+class QPdfWriter;
+
+// All about page and font, which is the same for any file to convert.
+// To resolve the font and calculate maxChar and maxLines is not for free, so
+// do it once by resolve() and use the result for as many files as you like
+struct PageSetup
+{
+    // Like QPrinter::HighResolution
+    static constexpr int Resolution = 1200;
+
+    enum Backend {
+        QtBackend,      // By QPdfWriter, can handle any font
+        NativeBackend   // By PdfRenderer, faster but TrueType only
+    };
+
+    static constexpr const char *DefaultFontFamily = "Hack";
+    static constexpr int DefaultFontSize = 10;
+    static constexpr qreal DefaultMargin = 5.0;
+
+    QString                  fontFamily = DefaultFontFamily;
+    QString                  fontStyle;
+    int                      fontSize = DefaultFontSize;
+    QPageSize                pageSize = QPageSize(QPageSize::A4);
+    QPageLayout::Orientation pageOrientation = QPageLayout::Portrait;
+    QMarginsF                margins = QMarginsF(DefaultMargin, DefaultMargin, DefaultMargin, DefaultMargin); // In millimeter
+    Backend                  backend = QtBackend;
+    // Only used by the native backend, QPdfWriter gives no control
+    int                      compression = 6;       // 0 none, 1 fast...9 small
+    bool                     objectStreams = false; // Needs PDF 1.5
+
+    // Filled by resolve()
+    QFont                    font;
+    int                      maxChar = 0;
+    int                      maxLines = 0;
+    int                      resolution = 0;    // Of the PDF, in dpi
+    qreal                    lineHeight = 0.0;  // In points
+    qreal                    ascent = 0.0;      // In points
+    QString                  usedFamily;
+    QString                  usedStyle;
+    int                      usedPointSize = 0;
+    bool                     fixedPitch = false;
+
+    // Take the settings as the command line options give them. On a bad value
+    // is false returned and nothing changed
+    // 'Mono', '10', 'Mono,10', 'Mono,Bold' or 'Mono,Bold,10', what is missing is the default
+    bool parseFont(const QString &desc);
+    // Any QPageSize::key(), like 'A4' or 'Letter', the case doesn't matter
+    bool parsePageSize(const QString &key);
+    // 'left,right,top,bottom' in millimeter, omitted ones are the default
+    bool parseMargins(const QString &list);
+    // 'qt' or 'native'
+    bool parseBackend(const QString &name);
+    // '0' up to '9'
+    bool parseCompression(const QString &level);
+
+    // With a cache is no font matching needed when we had the font before
+    void resolve(FontCache *cache = nullptr);
+    void applyTo(QPdfWriter *writer) const;
+    QPageLayout pageLayout() const;
+};
+
+// A QFont copy shares its engine cache with the original, but that cache is not
+// made to be used by more threads. This one is all new and set to dpi
+QFont independentFont(const QString &fontDesc, int dpi);
+
+#endif
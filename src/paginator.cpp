@@ -0,0 +1,143 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "paginator.h"
+#include "textlayout.h"
+#include "textsource.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+// Bytes at begin and end of the indexed text which must still be the same
+const qint64 HashSample = 64 * 1024;
+
+// Not all of the text, that would cost nearly as much as to count it again.
+// But head and end of what was indexed tell if it's an other or edited file,
+// together with the size which must also be the same
+static QByteArray textHash(const QString &textFile, qint64 size)
+{
+    QFile file(textFile);
+    if (! file.open(QIODevice::ReadOnly) or file.size() < size) return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    const qint64 sample = qMin(size, HashSample);
+    hash.addData(file.read(sample));
+    if (size > sample and file.seek(size - sample)) hash.addData(file.read(sample));
+
+    return hash.result().toHex();
+}
+
+qint64 countPages(TextSource *source, int maxChar, int maxLines
+                , const std::function<bool(const PageStart &)> &pageFunc)
+{
+    qint64 rows = 0;        // Before the current line
+    qint64 nextPageRow = 0; // First row of the next page
+    PageStart start;
+
+    QByteArrayView raw;
+    qint64 offset = source->bytesRead();
+    while (source->readRawLine(&raw)) {
+        const qint64 lineRows = source->lineIsAscii() ? TextLayout::rowCount(raw, maxChar)
+                                                      : TextLayout::rowCount(source->decode(raw), maxChar);
+        ++start.line;
+
+        // A long line may run over more than one page
+        while (nextPageRow < rows + lineRows) {
+            ++start.page;
+            start.offset = offset;
+            start.rowSkip = nextPageRow - rows;
+            if (pageFunc and ! pageFunc(start)) return start.page;
+            nextPageRow += maxLines;
+        }
+
+        rows += lineRows;
+        offset = source->bytesRead();
+    }
+
+    // Even without any text there is one page
+    if (start.page == 0) {
+        start.page = 1;
+        start.line = 1;
+        start.offset = offset;
+        if (pageFunc) pageFunc(start);
+    }
+
+    return start.page;
+}
+
+QByteArray pageIndexHeader(int maxChar, int maxLines, const QString &textFile, qint64 textSize)
+{
+    return "#page-index columns=" + QByteArray::number(maxChar) + " rows=" + QByteArray::number(maxLines)
+         + " bytes=" + QByteArray::number(textSize) + " hash=" + textHash(textFile, textSize)
+         + "\n# page line offset skip\n";
+}
+
+bool lookupPageIndex(const QString &indexFile, qint64 page, int maxChar, int maxLines, const QString &textFile, PageStart *start)
+{
+    QFile file(indexFile);
+    if (! file.open(QIODevice::ReadOnly) or file.size() == 0) return false;
+
+    const uchar *map = file.map(0, file.size());
+    if (! map) return false;
+    const QByteArrayView data(map, file.size());
+
+    // The text may have grown since, but what was indexed must still be there
+    const qsizetype headerEnd = data.indexOf('\n');
+    const QList<QByteArray> header = data.first(qMax(qsizetype(0), headerEnd)).toByteArray().split(' ');
+    if (header.size() != 5 or header.at(0) != "#page-index"
+        or header.at(1) != "columns=" + QByteArray::number(maxChar)
+        or header.at(2) != "rows=" + QByteArray::number(maxLines)
+        or ! header.at(3).startsWith("bytes=") or ! header.at(4).startsWith("hash=")) {
+        return false;
+    }
+    const qint64 textSize = header.at(3).mid(6).toLongLong();
+    const QByteArray hash = textHash(textFile, textSize);
+    if (hash.isEmpty() or header.at(4).mid(5) != hash) return false;
+
+    // Each line is one page, in order. So we can bisect it like an array, we
+    // only have to find the begin of the line we hit
+    qsizetype lo = headerEnd + 1;
+    qsizetype hi = data.size();
+    while (lo < hi) {
+        qsizetype lineStart = lo + (hi - lo) / 2;
+        while (lineStart > lo and data.at(lineStart - 1) != '\n') --lineStart;
+        qsizetype lineEnd = data.indexOf('\n', lineStart);
+        if (lineEnd < 0) lineEnd = data.size();
+
+        const QList<QByteArray> fields = data.sliced(lineStart, lineEnd - lineStart).toByteArray().split(' ');
+        const qint64 linePage = fields.at(0).startsWith('#') ? 0 : fields.at(0).toLongLong();
+        if (linePage < page) {
+            lo = lineEnd + 1;
+        } else if (linePage > page) {
+            hi = lineStart;
+        } else if (fields.size() == 4) {
+            start->page = linePage;
+            start->line = fields.at(1).toLongLong();
+            start->offset = fields.at(2).toLongLong();
+            start->rowSkip = fields.at(3).toLongLong();
+            return start->offset <= textSize;
+        } else {
+            return false;
+        }
+    }
+
+    return false;
+}
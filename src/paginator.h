@@ -0,0 +1,59 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef PAGINATOR_H
+#define PAGINATOR_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <functional>
+
+class TextSource;
+
+// Where a page begins in the text
+struct PageStart
+{
+    qint64 page = 0;    // All counted from 1
+    qint64 line = 0;
+    qint64 offset = 0;  // In bytes, of the line
+    qint64 rowSkip = 0; // Rows of the line which are on the page before
+};
+
+// Count the pages the text of source will give, without any rendering. The
+// rows are only counted by TextLayout::rowCount(), not cut, and pure ASCII
+// lines are not even decoded. So we run nearly as fast as the bytes are read.
+// When given, pageFunc is called for each page as soon as it begins. When it
+// return false we stop there, the count is then up to that page
+qint64 countPages(TextSource *source, int maxChar, int maxLines
+                , const std::function<bool(const PageStart &)> &pageFunc = nullptr);
+
+// Find the start of page in an index written by --page-index. False if the
+// index don't fit to maxChar, maxLines and textFile, or don't reach that far.
+// The text may have grown since, but what was indexed must be unchanged. We
+// don't read it all, it's sorted so we bisect it
+bool lookupPageIndex(const QString &indexFile, qint64 page, int maxChar, int maxLines, const QString &textFile, PageStart *start);
+
+// The first line of such index, with what is needed to tell if it fits. Only
+// for a text file, which was indexed up to textSize
+QByteArray pageIndexHeader(int maxChar, int maxLines, const QString &textFile, qint64 textSize);
+
+#endif
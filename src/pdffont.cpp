@@ -0,0 +1,446 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "pdffont.h"
+#include "pdfwriter.h"
+#include "textlayout.h"
+
+#include <QDataStream>
+#include <QHash>
+
+// Only the tables needed to draw glyphs, as in PDF spec 9.9 for FontFile2
+static const char *const EmbeddedTables[] = {
+    "cvt ", "fpgm", "glyf", "head", "hhea", "hmtx", "loca", "maxp", "prep"
+};
+
+namespace {
+
+// TrueType is big endian
+quint16 u16(const QByteArray &data, quint32 pos)
+{
+    if (pos + 2 > quint32(data.size())) return 0;
+    return (uchar(data.at(pos)) << 8) | uchar(data.at(pos + 1));
+}
+
+quint32 u32(const QByteArray &data, quint32 pos)
+{
+    return (quint32(u16(data, pos)) << 16) | u16(data, pos + 2);
+}
+
+void putU16(QByteArray *data, quint16 value)
+{
+    data->append(char(value >> 8));
+    data->append(char(value));
+}
+
+void putU32(QByteArray *data, quint32 value)
+{
+    putU16(data, value >> 16);
+    putU16(data, value);
+}
+
+void setU32(QByteArray *data, int pos, quint32 value)
+{
+    (*data)[pos]     = char(value >> 24);
+    (*data)[pos + 1] = char(value >> 16);
+    (*data)[pos + 2] = char(value >> 8);
+    (*data)[pos + 3] = char(value);
+}
+
+quint32 checksum(const QByteArray &data)
+{
+    quint32 sum = 0;
+    for (qsizetype i = 0; i < data.size(); i += 4) {
+        quint32 word = 0;
+        for (int b = 0; b < 4; ++b) {
+            word = (word << 8) | ((i + b < data.size()) ? uchar(data.at(i + b)) : 0);
+        }
+        sum += word;
+    }
+    return sum;
+}
+
+void appendHex(QByteArray *out, quint32 value, int digits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+        out->append(hex[(value >> shift) & 0xF]);
+    }
+}
+
+// As UTF-16BE, which is what ToUnicode wants
+void appendUnicodeHex(QByteArray *out, char32_t ucs)
+{
+    if (QChar::requiresSurrogates(ucs)) {
+        appendHex(out, QChar::highSurrogate(ucs), 4);
+        appendHex(out, QChar::lowSurrogate(ucs), 4);
+    } else {
+        appendHex(out, ucs, 4);
+    }
+}
+
+} // namespace
+
+PdfFont::PdfFont(const QRawFont &rawFont)
+    : m_rawFont(rawFont)
+{
+    m_head = table("head");
+    m_hhea = table("hhea");
+    m_hmtx = table("hmtx");
+    m_loca = table("loca");
+    m_glyf = table("glyf");
+
+    if (m_head.size() < 54 or m_hhea.size() < 36 or m_hmtx.isEmpty() or m_loca.isEmpty() or m_glyf.isEmpty()) {
+        return; // Not a TrueType font, m_numGlyphs stays 0
+    }
+
+    m_numGlyphs = u16(table("maxp"), 4);
+    m_unitsPerEm = qMax(16, int(u16(m_head, 18)));
+    m_longLoca = u16(m_head, 50) == 1;
+    m_used.resize(m_numGlyphs);
+}
+
+QByteArray PdfFont::table(const char *tag) const
+{
+    return m_rawFont.fontTable(tag);
+}
+
+void PdfFont::appendText(QStringView text, QByteArray *content)
+{
+    m_glyphBuffer.resize(text.size());
+    int numGlyphs = text.size();
+    m_rawFont.glyphIndexesForChars(text.data(), text.size(), m_glyphBuffer.data(), &numGlyphs);
+
+    const qsizetype start = content->size();
+    bool stepBack = false;
+    *content += '<';
+
+    // There is one glyph for each code point
+    qsizetype pos = 0;
+    for (int i = 0; i < numGlyphs and pos < text.size(); ++i) {
+        char32_t ucs = text.at(pos++).unicode();
+        if (QChar::isHighSurrogate(ucs) and pos < text.size() and text.at(pos).isLowSurrogate()) {
+            ucs = QChar::surrogateToUcs4(char16_t(ucs), text.at(pos++).unicode());
+        }
+
+        quint32 glyph = m_glyphBuffer.at(i);
+        if (glyph >= quint32(m_numGlyphs)) glyph = 0;
+
+        if (! m_used.testBit(glyph)) {
+            m_used.setBit(glyph);
+            if (glyph) m_unicode.insert(glyph, ucs);
+            m_hasNewGlyphs = true;
+        }
+
+        appendHex(content, glyph, 4);
+
+        // A TJ number is in 1/1000 em and moves back, to the left
+        if (TextLayout::columns(ucs) == 0) {
+            const int width = advance(glyph);
+            if (width > 0) {
+                *content += "> " + QByteArray::number(width) + " <";
+                stepBack = true;
+            }
+        }
+    }
+
+    if (stepBack) {
+        content->insert(start, '[');
+        *content += ">] TJ ";
+    } else {
+        *content += "> Tj ";
+    }
+}
+
+bool PdfFont::glyphRange(quint32 glyph, quint32 *start, quint32 *end) const
+{
+    if (m_longLoca) {
+        *start = u32(m_loca, glyph * 4);
+        *end = u32(m_loca, glyph * 4 + 4);
+    } else {
+        *start = u16(m_loca, glyph * 2) * 2;
+        *end = u16(m_loca, glyph * 2 + 2) * 2;
+    }
+
+    return *start < *end and *end <= quint32(m_glyf.size());
+}
+
+void PdfFont::addComponents(quint32 glyph, QBitArray *keep) const
+{
+    quint32 start, end;
+    if (! glyphRange(glyph, &start, &end) or end - start < 10) return;
+    // A negative number of contours marks a composite glyph
+    if (qint16(u16(m_glyf, start)) >= 0) return;
+
+    enum {
+        ArgsAreWords    = 0x0001,
+        HaveScale       = 0x0008,
+        MoreComponents  = 0x0020,
+        HaveXYScale     = 0x0040,
+        HaveTwoByTwo    = 0x0080
+    };
+
+    for (quint32 pos = start + 10; pos + 4 <= end; ) {
+        const quint16 flags = u16(m_glyf, pos);
+        const quint16 component = u16(m_glyf, pos + 2);
+
+        if (component < m_numGlyphs and ! keep->testBit(component)) {
+            keep->setBit(component);
+            addComponents(component, keep);
+        }
+
+        pos += 4 + ((flags & ArgsAreWords) ? 4 : 2);
+        if (flags & HaveScale) pos += 2;
+        else if (flags & HaveXYScale) pos += 4;
+        else if (flags & HaveTwoByTwo) pos += 8;
+
+        if (! (flags & MoreComponents)) break;
+    }
+}
+
+QByteArray PdfFont::subsetFont() const
+{
+    QBitArray keep = m_used;
+    keep.setBit(0); // .notdef is always needed
+    for (int glyph = 0; glyph < m_numGlyphs; ++glyph) {
+        if (m_used.testBit(glyph)) addComponents(glyph, &keep);
+    }
+
+    // Unused glyphs become empty, so all keep their number
+    QByteArray glyf;
+    QByteArray loca;
+    for (int glyph = 0; glyph < m_numGlyphs; ++glyph) {
+        putU32(&loca, glyf.size());
+        quint32 start, end;
+        if (keep.testBit(glyph) and glyphRange(glyph, &start, &end)) {
+            glyf += m_glyf.mid(start, end - start);
+            while (glyf.size() % 4) glyf += '\0';
+        }
+    }
+    putU32(&loca, glyf.size());
+
+    QByteArray head = m_head;
+    setU32(&head, 8, 0);                        // checkSumAdjustment, see below
+    head[50] = 0; head[51] = 1;                 // We always use long loca
+
+    QList<QPair<QByteArray, QByteArray>> tables;
+    for (const char *tag : EmbeddedTables) {
+        QByteArray data;
+        if (! qstrcmp(tag, "glyf")) data = glyf;
+        else if (! qstrcmp(tag, "loca")) data = loca;
+        else if (! qstrcmp(tag, "head")) data = head;
+        else data = table(tag);
+
+        if (! data.isEmpty()) tables.append({tag, data});
+    }
+
+    const quint16 numTables = tables.size();
+    quint16 entrySelector = 0;
+    while ((2 << entrySelector) <= numTables) ++entrySelector;
+    const quint16 searchRange = (1 << entrySelector) * 16;
+
+    QByteArray font;
+    putU32(&font, 0x00010000);
+    putU16(&font, numTables);
+    putU16(&font, searchRange);
+    putU16(&font, entrySelector);
+    putU16(&font, numTables * 16 - searchRange);
+
+    // The tables are already sorted by tag, as needed
+    quint32 offset = 12 + numTables * 16;
+    int headOffset = 0;
+    for (const auto &t : std::as_const(tables)) {
+        if (t.first == "head") headOffset = offset;
+        font += t.first;
+        putU32(&font, checksum(t.second));
+        putU32(&font, offset);
+        putU32(&font, t.second.size());
+        offset += (t.second.size() + 3) & ~3;
+    }
+
+    for (const auto &t : std::as_const(tables)) {
+        font += t.second;
+        while (font.size() % 4) font += '\0';
+    }
+
+    setU32(&font, headOffset + 8, 0xB1B0AFBA - checksum(font));
+
+    return font;
+}
+
+int PdfFont::advance(quint32 glyph) const
+{
+    // Glyphs behind the last metric have the same advance as the last one
+    const quint32 numMetrics = qMax(1, int(u16(m_hhea, 34)));
+    const quint32 index = qMin(glyph, numMetrics - 1);
+    return qRound(u16(m_hmtx, index * 4) * 1000.0 / m_unitsPerEm);
+}
+
+QByteArray PdfFont::widths() const
+{
+    // Fixed pitch is what we like, so there should be mostly one width
+    QHash<int, int> count;
+    for (int glyph = 0; glyph < m_numGlyphs; ++glyph) {
+        if (m_used.testBit(glyph)) ++count[advance(glyph)];
+    }
+
+    int defaultWidth = 0;
+    int most = 0;
+    for (auto it = count.cbegin(); it != count.cend(); ++it) {
+        if (it.value() <= most) continue;
+        most = it.value();
+        defaultWidth = it.key();
+    }
+
+    QByteArray w;
+    for (int glyph = 0; glyph < m_numGlyphs; ++glyph) {
+        if (! m_used.testBit(glyph)) continue;
+        const int width = advance(glyph);
+        if (width == defaultWidth) continue;
+        w += QByteArray::number(glyph) + " [" + QByteArray::number(width) + "] ";
+    }
+
+    return " /DW " + QByteArray::number(defaultWidth) + " /W [" + w.trimmed() + "]";
+}
+
+QByteArray PdfFont::fontName() const
+{
+    // Six capital letters in front are needed to mark a subset
+    QByteArray tag;
+    uint hash = qHash(m_used);
+    for (int i = 0; i < 6; ++i, hash /= 26) tag += char('A' + hash % 26);
+
+    QByteArray name;
+    const QString fullName = m_rawFont.familyName() + '-' + m_rawFont.styleName();
+    for (const QChar c : fullName) {
+        if (c.isLetterOrNumber() and c.unicode() < 128) name += char(c.unicode());
+        else if (c == '-') name += '-';
+    }
+
+    return "/" + tag + "+" + name;
+}
+
+QByteArray PdfFont::toUnicodeCMap() const
+{
+    QByteArray cmap =
+        "/CIDInit /ProcSet findresource begin\n"
+        "12 dict begin\n"
+        "begincmap\n"
+        "/CIDSystemInfo << /Registry (Adobe) /Ordering (UCS) /Supplement 0 >> def\n"
+        "/CMapName /Adobe-Identity-UCS def\n"
+        "/CMapType 2 def\n"
+        "1 begincodespacerange\n"
+        "<0000> <FFFF>\n"
+        "endcodespacerange\n";
+
+    // Not more than 100 entries in one block
+    QByteArray block;
+    int inBlock = 0;
+    for (auto it = m_unicode.cbegin(); it != m_unicode.cend(); ++it) {
+        block += '<';
+        appendHex(&block, it.key(), 4);
+        block += "> <";
+        appendUnicodeHex(&block, it.value());
+        block += ">\n";
+
+        if (++inBlock == 100 or std::next(it) == m_unicode.cend()) {
+            cmap += QByteArray::number(inBlock) + " beginbfchar\n" + block + "endbfchar\n";
+            block.clear();
+            inBlock = 0;
+        }
+    }
+
+    cmap +=
+        "endcmap\n"
+        "CMapName currentdict /CMap defineresource pop\n"
+        "end\n"
+        "end\n";
+
+    return cmap;
+}
+
+void PdfFont::write(PdfWriter *writer, int fontId) const
+{
+    const int cidFontId = writer->newObject();
+    const int descriptorId = writer->newObject();
+    const int fileId = writer->newObject();
+    const int toUnicodeId = writer->newObject();
+    const QByteArray name = fontName();
+
+    writer->writeObject(fontId, "<< /Type /Font /Subtype /Type0 /BaseFont " + name
+                        + " /Encoding /Identity-H /DescendantFonts [" + PdfWriter::reference(cidFontId)
+                        + "] /ToUnicode " + PdfWriter::reference(toUnicodeId) + " >>");
+
+    writer->writeObject(cidFontId, "<< /Type /Font /Subtype /CIDFontType2 /BaseFont " + name
+                        + " /CIDSystemInfo << /Registry (Adobe) /Ordering (Identity) /Supplement 0 >>"
+                        + " /FontDescriptor " + PdfWriter::reference(descriptorId)
+                        + " /CIDToGIDMap /Identity" + widths() + " >>");
+
+    // Values in glyph space, which is 1000 units per em
+    auto scaled = [this](qint16 value) {
+        return QByteArray::number(qRound(value * 1000.0 / m_unitsPerEm));
+    };
+    const QByteArray ascent = scaled(qint16(u16(m_hhea, 4)));
+    const QByteArray bbox = scaled(qint16(u16(m_head, 36))) + ' ' + scaled(qint16(u16(m_head, 38))) + ' '
+                          + scaled(qint16(u16(m_head, 40))) + ' ' + scaled(qint16(u16(m_head, 42)));
+    // Symbolic, because we don't use any standard encoding
+    const int flags = (u32(table("post"), 12) ? 1 : 0) | 4;
+
+    writer->writeObject(descriptorId, "<< /Type /FontDescriptor /FontName " + name
+                        + " /Flags " + QByteArray::number(flags)
+                        + " /FontBBox [" + bbox + "] /ItalicAngle 0"
+                        + " /Ascent " + ascent
+                        + " /Descent " + scaled(qint16(u16(m_hhea, 6)))
+                        + " /CapHeight " + ascent
+                        + " /StemV 80 /FontFile2 " + PdfWriter::reference(fileId) + " >>");
+
+    const QByteArray font = subsetFont();
+    writer->writeStream(fileId, " /Length1 " + QByteArray::number(font.size()), font);
+    writer->writeStream(toUnicodeId, QByteArray(), toUnicodeCMap());
+}
+
+QByteArray PdfFont::saveState() const
+{
+    QByteArray state;
+    QDataStream out(&state, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << m_used << m_unicode;
+
+    return state;
+}
+
+bool PdfFont::restoreState(const QByteArray &state)
+{
+    QBitArray used;
+    QMap<quint32, char32_t> unicode;
+    QDataStream in(state);
+    in.setVersion(QDataStream::Qt_6_0);
+    in >> used >> unicode;
+
+    // Some other font? No way
+    if (in.status() != QDataStream::Ok or used.size() != m_numGlyphs) return false;
+
+    m_used = used;
+    m_unicode = unicode;
+    m_hasNewGlyphs = false;
+
+    return true;
+}
@@ -0,0 +1,88 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef PDFFONT_H
+#define PDFFONT_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QRawFont>
+#include <QString>
+#include <QStringView>
+
+class PdfWriter;
+
+// Embed a TrueType font as composite font, text is written as glyph numbers.
+// Only the used glyphs are embedded, but they keep their number so we don't
+// need to translate anything. The glyph to unicode map keeps the text
+// searchable and copy/paste working
+class PdfFont
+{
+public:
+    explicit PdfFont(const QRawFont &rawFont);
+
+    // Fonts with CFF outlines are not supported
+    bool isValid() const { return m_numGlyphs > 0; }
+    const QRawFont &rawFont() const { return m_rawFont; }
+
+    // Append the operator to show text, as "<hex> Tj". Combining marks take
+    // no column in TextLayout, but a monospace font often give them a full
+    // advance. Then we step back after each by "[<hex> 600 <hex>] TJ"
+    void appendText(QStringView text, QByteArray *content);
+
+    // Write all needed objects, fontId is the one to be referenced
+    void write(PdfWriter *writer, int fontId) const;
+
+    // The used glyphs, to continue a PDF later with the same font
+    QByteArray saveState() const;
+    bool restoreState(const QByteArray &state);
+    // Since restoreState(), when not, the font need to be written again
+    bool hasNewGlyphs() const { return m_hasNewGlyphs; }
+
+private:
+    QByteArray table(const char *tag) const;
+    QByteArray subsetFont() const;
+    QByteArray toUnicodeCMap() const;
+    QByteArray widths() const;
+    QByteArray fontName() const;
+    int  advance(quint32 glyph) const;
+    bool glyphRange(quint32 glyph, quint32 *start, quint32 *end) const;
+    void addComponents(quint32 glyph, QBitArray *keep) const;
+
+    QRawFont                m_rawFont;
+    QByteArray              m_head;
+    QByteArray              m_hhea;
+    QByteArray              m_hmtx;
+    QByteArray              m_loca;
+    QByteArray              m_glyf;
+    int                     m_numGlyphs = 0;
+    int                     m_unitsPerEm = 1000;
+    bool                    m_longLoca = false;
+    bool                    m_hasNewGlyphs = false;
+
+    QBitArray               m_used;
+    QMap<quint32, char32_t> m_unicode;
+    QList<quint32>          m_glyphBuffer;
+};
+
+#endif
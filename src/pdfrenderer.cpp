@@ -0,0 +1,276 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "pdfrenderer.h"
+#include "pagesetup.h"
+#include "textlayout.h"
+
+#include <QCoreApplication>
+#include <QRawFont>
+#include <QSemaphore>
+
+// A finished page, waiting for its content stream to be compressed
+struct PdfRenderer::PackedPage
+{
+    int        contentId = 0;
+    int        pageId = 0;
+    QByteArray content;     // Packed when done
+    QSemaphore done;
+};
+
+PdfRenderer::PdfRenderer(QIODevice *device, const QFont &font, const PageSetup &setup)
+    : m_writer(device)
+    , m_font(QRawFont::fromFont(font))
+    , m_setup(setup)
+{
+    // The raw font is in printer pixel, we want points
+    m_fontSize = m_font.rawFont().pixelSize() * 72.0 / setup.resolution;
+    m_writer.setCompression(setup.compression);
+    m_writer.setObjectStreams(setup.objectStreams);
+}
+
+bool PdfRenderer::supports(const QFont &font)
+{
+    return PdfFont(QRawFont::fromFont(font)).isValid();
+}
+
+PdfRenderer::~PdfRenderer()
+{
+    // Only when finish() was not called, don't leave running tasks behind
+    m_pool.waitForDone();
+}
+
+bool PdfRenderer::begin()
+{
+    if (! m_font.isValid()) {
+        m_errorString = "Font not supported by native backend, only TrueType: " + m_setup.font.family();
+        return false;
+    }
+
+    if (! m_writer.begin()) {
+        m_errorString = "Can't write PDF";
+        return false;
+    }
+
+    m_pagesId = m_writer.newObject();
+    m_fontId = m_writer.newObject();
+    m_pageIds.clear();
+    setupPages();
+    if (m_threads > 1) m_pool.setMaxThreadCount(m_threads);
+
+    return true;
+}
+
+bool PdfRenderer::resume(const PdfResumeState &state)
+{
+    if (! m_font.isValid() or ! m_font.restoreState(state.fontState) or state.pageIds.isEmpty()) {
+        m_errorString = "Can't continue PDF, font has changed";
+        return false;
+    }
+
+    m_writer.beginUpdate(state.fileSize, state.xrefPos, state.objectCount);
+    m_pagesId = state.pagesId;
+    m_fontId = state.fontId;
+    m_catalogId = state.catalogId;
+    m_infoId = state.infoId;
+    m_pageIds = state.pageIds;
+    m_reusePageId = m_pageIds.takeLast();
+    m_skipRows = state.lastPageRowSkip;
+    m_lastPageOffset = state.lastPageOffset;
+    m_lastPageRowSkip = state.lastPageRowSkip;
+    setupPages();
+    if (m_threads > 1) m_pool.setMaxThreadCount(m_threads);
+
+    return true;
+}
+
+PdfResumeState PdfRenderer::state() const
+{
+    PdfResumeState state;
+    state.fileSize = m_writer.pos();
+    state.xrefPos = m_writer.xrefPos();
+    state.objectCount = m_writer.objectCount();
+    state.pagesId = m_pagesId;
+    state.catalogId = m_catalogId;
+    state.infoId = m_infoId;
+    state.fontId = m_fontId;
+    state.pageIds = m_pageIds;
+    state.fontState = m_font.saveState();
+    state.lastPageOffset = m_lastPageOffset;
+    state.lastPageRowSkip = m_lastPageRowSkip;
+
+    return state;
+}
+
+void PdfRenderer::setupPages()
+{
+    m_row = 0;
+
+    // PDF has the origin at the bottom, we start at the top left of our print
+    // area. Each row is one string, T* move to the next
+    const QPageLayout layout = m_setup.pageLayout();
+    const QRectF page = layout.fullRect(QPageLayout::Point);
+    const QRectF area = layout.paintRect(QPageLayout::Point);
+
+    m_pageStart = "BT\n/F1 " + PdfWriter::number(m_fontSize) + " Tf\n"
+                + PdfWriter::number(m_setup.lineHeight) + " TL\n"
+                + PdfWriter::number(area.left()) + ' '
+                + PdfWriter::number(page.height() - area.top() - m_setup.ascent) + " Td\n";
+
+    m_pageDict = "/Type /Page /Parent " + PdfWriter::reference(m_pagesId)
+               + " /MediaBox [0 0 " + PdfWriter::number(page.width()) + ' ' + PdfWriter::number(page.height()) + "]"
+               + " /Resources << /Font << /F1 " + PdfWriter::reference(m_fontId) + " >> /ProcSet [/PDF /Text] >>";
+
+    m_content = m_pageStart;
+}
+
+void PdfRenderer::addLine(QStringView line)
+{
+    m_rowInLine = 0;
+    line = TextLayout::expandTabs(line, m_tabBuffer);
+    TextLayout::wrapLine(line, m_setup.maxChar, [this](QStringView row) { addRow(row); });
+}
+
+void PdfRenderer::addRow(QStringView row)
+{
+    // These rows are on the page before, which we don't touch
+    if (m_skipRows > 0) {
+        --m_skipRows;
+        ++m_rowInLine;
+        return;
+    }
+
+    if (m_stats) {
+        m_stats->enter(Stats::Print);
+        ++m_stats->rows;
+    }
+
+    if (m_row == m_setup.maxLines) finishPage();
+
+    // Remember where the page begins, to do it again on the next update
+    if (m_row == 0) {
+        m_lastPageOffset = m_sourcePos;
+        m_lastPageRowSkip = m_rowInLine;
+    }
+    ++m_rowInLine;
+
+    // Empty rows only need to be counted
+    if (! row.isEmpty()) m_font.appendText(row, &m_content);
+    m_content += "T*\n";
+
+    ++m_row;
+    if (m_stats) m_stats->enter(Stats::Layout);
+}
+
+void PdfRenderer::finishPage()
+{
+    m_content += "ET\n";
+
+    // The numbers are taken now, so the order is the same no matter which
+    // page is compressed first
+    auto page = std::make_unique<PackedPage>();
+    page->contentId = m_writer.newObject();
+    page->pageId = m_reusePageId ? m_reusePageId : m_writer.newObject();
+    page->content = std::move(m_content);
+    m_reusePageId = 0;
+    m_pageIds.append(page->pageId);
+
+    m_content = m_pageStart;
+    m_row = 0;
+
+    if (m_threads < 2) {
+        page->content = m_writer.pack(page->content);
+        page->done.release();
+        writePage(page.get());
+        return;
+    }
+
+    PackedPage *p = page.get();
+    const PdfWriter *writer = &m_writer;
+    m_pool.start([p, writer]() {
+        p->content = writer->pack(p->content);
+        p->done.release();
+    });
+    m_inProgress.push_back(std::move(page));
+
+    // Write what is done already, the reader on the other end should not wait
+    while (! m_inProgress.empty() and m_inProgress.front()->done.available() > 0) {
+        writePage(m_inProgress.front().get());
+        m_inProgress.pop_front();
+    }
+
+    // Don't run away, the memory should stay low
+    while (m_inProgress.size() > size_t(m_threads) * 2) {
+        writePage(m_inProgress.front().get());
+        m_inProgress.pop_front();
+    }
+}
+
+void PdfRenderer::writePage(PackedPage *page)
+{
+    page->done.acquire();
+    m_writer.writePackedStream(page->contentId, QByteArray(), page->content);
+    m_writer.writeObject(page->pageId, "<< " + m_pageDict + " /Contents " + PdfWriter::reference(page->contentId) + " >>");
+    // Let the reader on the other end of a pipe start with the page
+    m_writer.flush();
+}
+
+bool PdfRenderer::finish()
+{
+    // Even without any text we want one page
+    if (m_stats) m_stats->enter(Stats::Print);
+    if (m_row > 0 or m_pageIds.isEmpty() or m_reusePageId) finishPage();
+    while (! m_inProgress.empty()) {
+        writePage(m_inProgress.front().get());
+        m_inProgress.pop_front();
+    }
+
+    if (m_stats) m_stats->enter(Stats::Write);
+    // A resumed PDF has the font already, unless we need some more glyphs
+    if (! m_catalogId or m_font.hasNewGlyphs()) m_font.write(&m_writer, m_fontId);
+
+    QByteArray kids;
+    for (const int id : std::as_const(m_pageIds)) {
+        kids += PdfWriter::reference(id) + ' ';
+    }
+    m_writer.writeObject(m_pagesId, "<< /Type /Pages /Kids [" + kids.trimmed()
+                         + "] /Count " + QByteArray::number(m_pageIds.size()) + " >>");
+
+    // Catalog and info stay as they are on update
+    if (! m_catalogId) {
+        m_catalogId = m_writer.newObject();
+        m_writer.writeObject(m_catalogId, "<< /Type /Catalog /Pages " + PdfWriter::reference(m_pagesId) + " >>");
+
+        m_infoId = m_writer.newObject();
+        QByteArray info = "<< /Creator " + PdfWriter::textString(QCoreApplication::applicationName() + " v" + QCoreApplication::applicationVersion())
+                        + " /Producer " + PdfWriter::textString(QCoreApplication::applicationName())
+                        + " /CreationDate " + PdfWriter::dateString();
+        if (! m_docName.isEmpty()) info += " /Title " + PdfWriter::textString(m_docName);
+        m_writer.writeObject(m_infoId, info + " >>");
+    }
+
+    if (! m_writer.finish(m_catalogId, m_infoId)) {
+        m_errorString = "Can't write PDF";
+        return false;
+    }
+
+    return true;
+}
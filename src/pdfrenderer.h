@@ -0,0 +1,125 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef PDFRENDERER_H
+#define PDFRENDERER_H
+
+#include <QByteArray>
+#include <QFont>
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+
+#include <deque>
+#include <memory>
+
+#include "pdffont.h"
+#include "pdfwriter.h"
+#include "renderer.h"
+
+class QIODevice;
+struct PageSetup;
+
+// Where a PDF ends, so it can be continued later by an incremental update
+struct PdfResumeState
+{
+    qint64     fileSize = 0;
+    qint64     xrefPos = 0;
+    int        objectCount = 0;
+    int        pagesId = 0;
+    int        catalogId = 0;
+    int        infoId = 0;
+    int        fontId = 0;
+    QList<int> pageIds;
+    QByteArray fontState;
+    qint64     lastPageOffset = 0;  // In the text, of the line the last page begins with...
+    int        lastPageRowSkip = 0; // ...and its rows which are on the page before
+};
+
+// Write the PDF on our own, without QPdfWriter and all its machinery. For plain
+// text in one fixed pitch font we need so little: Each row is one string of
+// glyphs, the font take care to place them side by side.
+// Only TrueType fonts are supported, everything else needs TextRenderer.
+// With more threads are the content streams compressed by a pool, the pages
+// are still written in the right order by us
+class PdfRenderer : public Renderer
+{
+public:
+    PdfRenderer(QIODevice *device, const QFont &font, const PageSetup &setup);
+    ~PdfRenderer() override;
+
+    // Ask once before any file is touched, begin() would fail for each one
+    static bool supports(const QFont &font);
+
+    void setThreads(int threads) { m_threads = qMax(1, threads); }
+
+    void setDocName(const QString &docName) { m_docName = docName; }
+
+    bool begin() override;
+    void addLine(QStringView line) override;
+    bool finish() override;
+
+    int pageCount() const override { return qMax(1, int(m_pageIds.size())); }
+
+    // Instead of begin(), continue the PDF of state, the device must be at its
+    // end. The last page is done again, so the text must start at its begin
+    bool resume(const PdfResumeState &state);
+    // Offset in the text of the next line, only needed for a useful state()
+    void setSourcePos(qint64 offset) { m_sourcePos = offset; }
+    // After finish()
+    PdfResumeState state() const;
+
+private:
+    struct PackedPage;
+
+    void setupPages();
+    void addRow(QStringView row);
+    void finishPage();
+    void writePage(PackedPage *page);
+
+    PdfWriter        m_writer;
+    PdfFont          m_font;
+    const PageSetup &m_setup;
+    QString          m_docName;
+    QString          m_tabBuffer;
+    QByteArray       m_pageStart;   // Content each page begins with
+    QByteArray       m_pageDict;    // Common entries of all pages
+    QByteArray       m_content;
+    QList<int>       m_pageIds;
+    int              m_row = 0;
+    int              m_pagesId = 0;
+    int              m_fontId = 0;
+    int              m_catalogId = 0;
+    int              m_infoId = 0;
+    int              m_reusePageId = 0;     // Of the last page when resumed
+    int              m_skipRows = 0;        // Already on the page before the resumed one
+    int              m_rowInLine = 0;
+    qint64           m_sourcePos = 0;
+    qint64           m_lastPageOffset = 0;
+    int              m_lastPageRowSkip = 0;
+    int              m_threads = 1;
+    qreal            m_fontSize = 0.0;
+
+    std::deque<std::unique_ptr<PackedPage>> m_inProgress;  // Compressed by the pool
+    QThreadPool      m_pool;
+};
+
+#endif
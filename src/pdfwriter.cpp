@@ -0,0 +1,262 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "pdfwriter.h"
+
+#include <QDateTime>
+#include <QFileDevice>
+#include <QIODevice>
+
+// Not too many, a reader has to unpack the whole stream to get one object
+const int ObjectsPerStream = 100;
+
+PdfWriter::PdfWriter(QIODevice *device)
+    : m_device(device)
+{
+}
+
+bool PdfWriter::begin()
+{
+    // The binary comment tell transfer programs to take care
+    write(m_objectStreams ? "%PDF-1.5\n%\xE2\xE3\xCF\xD3\n" : "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+    return ! m_error;
+}
+
+void PdfWriter::beginUpdate(qint64 pos, qint64 prevXrefPos, int objectCount)
+{
+    m_pos = pos;
+    m_prevXrefPos = prevXrefPos;
+    m_entries = QList<Entry>(objectCount);
+}
+
+int PdfWriter::newObject()
+{
+    m_entries.append(Entry());
+    return m_entries.size();
+}
+
+void PdfWriter::startObject(int id)
+{
+    m_entries[id - 1] = {m_pos, 0};
+    write(QByteArray::number(id) + " 0 obj\n");
+}
+
+void PdfWriter::writeObject(int id, const QByteArray &body)
+{
+    if (m_objectStreams) {
+        m_streamObjects.append({id, body});
+        if (m_streamObjects.size() == ObjectsPerStream) writeObjectStream();
+        return;
+    }
+
+    startObject(id);
+    write(body);
+    write("\nendobj\n");
+}
+
+void PdfWriter::writeObjectStream()
+{
+    if (m_streamObjects.isEmpty()) return;
+
+    // Pairs of number and offset, followed by the objects without any "obj"
+    QByteArray head;
+    QByteArray data;
+    const int streamId = newObject();
+    for (int i = 0; i < m_streamObjects.size(); ++i) {
+        const auto &object = m_streamObjects.at(i);
+        head += QByteArray::number(object.first) + ' ' + QByteArray::number(data.size()) + ' ';
+        data += object.second + '\n';
+        m_entries[object.first - 1] = {i, streamId};
+    }
+
+    writeStream(streamId, " /Type /ObjStm /N " + QByteArray::number(m_streamObjects.size())
+                          + " /First " + QByteArray::number(head.size()), head + data);
+    m_streamObjects.clear();
+}
+
+void PdfWriter::writeStream(int id, const QByteArray &dict, const QByteArray &data)
+{
+    writePackedStream(id, dict, pack(data));
+}
+
+QByteArray PdfWriter::pack(const QByteArray &data) const
+{
+    if (m_compression == 0) return data;
+
+    // Compression is not for free, but text shrinks that much, it's worth it.
+    // qCompress() put the size in front of the zlib stream, which we skip
+    return qCompress(data, m_compression).mid(4);
+}
+
+void PdfWriter::writePackedStream(int id, const QByteArray &dict, const QByteArray &packed)
+{
+    startObject(id);
+    write("<<" + dict + (m_compression ? " /Filter /FlateDecode" : "")
+          + " /Length " + QByteArray::number(packed.size()) + " >>\nstream\n");
+    write(packed);
+    write("\nendstream\nendobj\n");
+}
+
+bool PdfWriter::finish(int catalogId, int infoId)
+{
+    if (m_objectStreams) {
+        writeObjectStream();
+        writeXrefStream(catalogId, infoId);
+    } else {
+        writeXrefTable(catalogId, infoId);
+    }
+
+    return ! m_error;
+}
+
+QList<QPair<int, int>> PdfWriter::xrefSections() const
+{
+    // Object 0 is the head of the free list, not needed on update
+    if (m_prevXrefPos < 0) return {{0, int(m_entries.size()) + 1}};
+
+    // An update lists only what is new or replaced, in runs of consecutive
+    // numbers. The rest is found by /Prev in the sections before
+    QList<QPair<int, int>> sections;
+    for (int i = 0; i < m_entries.size(); ) {
+        if (m_entries.at(i).offset < 0) {
+            ++i;
+            continue;
+        }
+        int end = i;
+        while (end < m_entries.size() and m_entries.at(end).offset >= 0) ++end;
+        sections.append({i + 1, end - i});
+        i = end;
+    }
+
+    return sections;
+}
+
+void PdfWriter::writeXrefTable(int catalogId, int infoId)
+{
+    m_xrefPos = m_pos;
+
+    QByteArray xref = "xref\n";
+    for (const auto &section : xrefSections()) {
+        xref += QByteArray::number(section.first) + ' ' + QByteArray::number(section.second) + "\n";
+        for (int id = section.first; id < section.first + section.second; ++id) {
+            const qint64 offset = id ? m_entries.at(id - 1).offset : -1;
+            if (offset < 0) {
+                // Object 0, or reserved but never written, should not happen
+                xref += "0000000000 65535 f \n";
+                continue;
+            }
+            xref += QByteArray::number(offset).rightJustified(10, '0') + " 00000 n \n";
+        }
+    }
+    write(xref);
+
+    QByteArray trailer = "trailer\n<< /Size " + QByteArray::number(m_entries.size() + 1)
+                       + " /Root " + reference(catalogId)
+                       + " /Info " + reference(infoId);
+    if (m_prevXrefPos >= 0) trailer += " /Prev " + QByteArray::number(m_prevXrefPos);
+    write(trailer + " >>\nstartxref\n" + QByteArray::number(m_xrefPos) + "\n%%EOF\n");
+}
+
+void PdfWriter::writeXrefStream(int catalogId, int infoId)
+{
+    // The xref is an object itself and has to list itself
+    const int xrefId = newObject();
+    m_xrefPos = m_pos;
+    m_entries[xrefId - 1] = {m_xrefPos, 0};
+
+    // Each entry is type, offset or object stream, generation or index. The
+    // middle field is as wide as needed for the biggest offset
+    int width = 1;
+    while (width < 8 and (m_xrefPos >> (8 * width)) > 0) ++width;
+
+    QByteArray data;
+    QByteArray index;
+    auto append = [&data](qint64 value, int bytes) {
+        for (int i = bytes - 1; i >= 0; --i) data += char((value >> (8 * i)) & 0xFF);
+    };
+    for (const auto &section : xrefSections()) {
+        index += QByteArray::number(section.first) + ' ' + QByteArray::number(section.second) + ' ';
+        for (int id = section.first; id < section.first + section.second; ++id) {
+            const Entry entry = id ? m_entries.at(id - 1) : Entry();
+            if (entry.offset < 0) {
+                append(0, 1); append(0, width); append(65535, 2);
+            } else if (entry.stream) {
+                append(2, 1); append(entry.stream, width); append(entry.offset, 2);
+            } else {
+                append(1, 1); append(entry.offset, width); append(0, 2);
+            }
+        }
+    }
+
+    QByteArray dict = " /Type /XRef /Size " + QByteArray::number(m_entries.size() + 1)
+                    + " /Index [" + index.trimmed() + "]"
+                    + " /W [1 " + QByteArray::number(width) + " 2]"
+                    + " /Root " + reference(catalogId)
+                    + " /Info " + reference(infoId);
+    if (m_prevXrefPos >= 0) dict += " /Prev " + QByteArray::number(m_prevXrefPos);
+    writeStream(xrefId, dict, data);
+    write("startxref\n" + QByteArray::number(m_xrefPos) + "\n%%EOF\n");
+}
+
+void PdfWriter::flush()
+{
+    if (! m_device->isSequential()) return;
+
+    auto file = qobject_cast<QFileDevice *>(m_device);
+    if (file and ! file->flush()) m_error = true;
+}
+
+void PdfWriter::write(const QByteArray &data)
+{
+    if (m_device->write(data) != data.size()) m_error = true;
+    m_pos += data.size();
+}
+
+QByteArray PdfWriter::number(qreal value)
+{
+    QByteArray s = QByteArray::number(value, 'f', 3);
+    while (s.endsWith('0')) s.chop(1);
+    if (s.endsWith('.')) s.chop(1);
+    if (s == "-0") s = "0";
+
+    return s;
+}
+
+QByteArray PdfWriter::reference(int id)
+{
+    return QByteArray::number(id) + " 0 R";
+}
+
+QByteArray PdfWriter::textString(const QString &text)
+{
+    // UTF-16BE with BOM, as hex we need no escaping
+    QByteArray s = "<FEFF";
+    for (const QChar c : text) {
+        s += QByteArray::number(c.unicode(), 16).rightJustified(4, '0').toUpper();
+    }
+
+    return s + ">";
+}
+
+QByteArray PdfWriter::dateString()
+{
+    return "(D:" + QDateTime::currentDateTimeUtc().toString("yyyyMMddHHmmss").toLatin1() + "Z)";
+}
@@ -0,0 +1,105 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef PDFWRITER_H
+#define PDFWRITER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class QIODevice;
+
+// The very basic bricks of a PDF file: numbered objects, streams and at last
+// the cross reference table. Everything is written straight in sequence, we
+// never seek back, so the device can be anything writable
+class PdfWriter
+{
+public:
+    explicit PdfWriter(QIODevice *device);
+
+    // Both must be set before begin() or beginUpdate().
+    // Level 0 write streams as they are, 1 is fastest and 9 smallest
+    void setCompression(int level) { m_compression = qBound(0, level, 9); }
+    // Pack small objects into compressed object streams and write the cross
+    // reference as stream too, needs PDF 1.5
+    void setObjectStreams(bool enable) { m_objectStreams = enable; }
+
+    bool begin();
+    // Instead of begin(), continue a PDF which ends at pos by an incremental
+    // update. The device must be at its end already
+    void beginUpdate(qint64 pos, qint64 prevXrefPos, int objectCount);
+    // Close with xref table and trailer
+    bool finish(int catalogId, int infoId);
+
+    // Reserve a number, the object itself may be written later
+    int newObject();
+    void writeObject(int id, const QByteArray &body);
+    void writeStream(int id, const QByteArray &dict, const QByteArray &data);
+    // Compress data as writeStream() would do. It's the expensive part, and
+    // safe to call from any thread while we write other stuff...
+    QByteArray pack(const QByteArray &data) const;
+    // ...and the cheap part, data must be done by pack()
+    void writePackedStream(int id, const QByteArray &dict, const QByteArray &packed);
+    // Push out what is written so far, but only to a pipe where someone waits
+    void flush();
+
+    bool hasError() const { return m_error; }
+
+    // Needed to continue later by beginUpdate()
+    qint64 pos() const { return m_pos; }
+    qint64 xrefPos() const { return m_xrefPos; }
+    int objectCount() const { return m_entries.size(); }
+
+    // Some helpers to format values as PDF expect them
+    static QByteArray number(qreal value);
+    static QByteArray reference(int id);
+    static QByteArray textString(const QString &text);
+    static QByteArray dateString();
+
+private:
+    // Where to find an object. Inside an object stream is offset the index
+    struct Entry
+    {
+        qint64 offset = -1;     // -1 if not written
+        int    stream = 0;      // Number of the object stream, or 0
+    };
+
+    void startObject(int id);
+    void writeObjectStream();
+    void writeXrefTable(int catalogId, int infoId);
+    void writeXrefStream(int catalogId, int infoId);
+    // Runs of consecutive numbers which are written, all when not an update
+    QList<QPair<int, int>> xrefSections() const;
+    void write(const QByteArray &data);
+
+    QIODevice     *m_device;
+    qint64         m_pos = 0;
+    qint64         m_xrefPos = 0;
+    qint64         m_prevXrefPos = -1;  // Only set by an update
+    QList<Entry>   m_entries;           // Index is object number - 1
+    QList<QPair<int, QByteArray>> m_streamObjects; // Waiting for the next object stream
+    int            m_compression = 6;
+    bool           m_objectStreams = false;
+    bool           m_error = false;
+};
+
+#endif
@@ -0,0 +1,52 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <QString>
+#include <QStringView>
+
+#include "stats.h"
+
+// What each way to make a PDF out of lines must be able to do
+class Renderer
+{
+public:
+    virtual ~Renderer() = default;
+
+    virtual bool begin() = 0;
+    virtual void addLine(QStringView line) = 0;
+    virtual bool finish() = 0;
+
+    virtual int pageCount() const = 0;
+
+    // Switch between layout and print phase, the caller take care of the rest
+    void setStats(Stats *stats) { m_stats = stats; }
+
+    QString errorString() const { return m_errorString; }
+
+protected:
+    QString m_errorString;
+    Stats  *m_stats = nullptr;
+};
+
+#endif
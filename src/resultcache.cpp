@@ -0,0 +1,131 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "resultcache.h"
+#include "pagesetup.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRawFont>
+#include <QStandardPaths>
+
+ResultCache::ResultCache(const QString &copyDir)
+    : m_settings(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/results.cache", QSettings::IniFormat)
+    , m_copyDir(copyDir)
+{
+    if (! m_copyDir.isEmpty()) QDir().mkpath(m_copyDir);
+}
+
+QByteArray ResultCache::setupKey(const PageSetup &setup)
+{
+    const QMarginsF &m = setup.margins;
+    QByteArray key = QString("%1|%2|%3|%4|%5|%6|%7,%8,%9,%10|%11|%12|%13")
+                     .arg(QCoreApplication::applicationVersion(), setup.font.toString())
+                     .arg(setup.maxChar).arg(setup.maxLines).arg(setup.resolution)
+                     .arg(setup.pageSize.key()).arg(int(setup.pageOrientation))
+                     .arg(m.left()).arg(m.top()).arg(m.right()).arg(m.bottom())
+                     .arg(int(setup.backend)).arg(setup.compression).arg(setup.objectStreams).toUtf8();
+
+    // Same name but some other file, maybe an update of the font. The head
+    // table has its checksum and date, that's enough to tell them apart
+    key += QCryptographicHash::hash(QRawFont::fromFont(setup.font).fontTable("head"), QCryptographicHash::Md5).toHex();
+
+    return key;
+}
+
+QByteArray ResultCache::hash(const QString &txtFile, const QByteArray &key)
+{
+    QFile file(txtFile);
+    if (! file.open(QIODevice::ReadOnly)) return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(key);
+
+    // Straight over the mapping, nothing is copied. When it can't be mapped,
+    // for whatever reason, we read it in the usual way
+    const uchar *map = file.size() > 0 ? file.map(0, file.size()) : nullptr;
+    if (map) {
+        hash.addData(QByteArrayView(map, file.size()));
+    } else if (! hash.addData(&file)) {
+        return QByteArray();
+    }
+
+    return hash.result().toHex();
+}
+
+QString ResultCache::pathKey(const QString &pdfFile)
+{
+    // A path is not fine as key, QSettings takes the slashes as groups
+    const QString path = QFileInfo(pdfFile).absoluteFilePath();
+    return "pdf/" + QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Md5).toHex();
+}
+
+QByteArray ResultCache::fileState(const QString &pdfFile)
+{
+    const QFileInfo info(pdfFile);
+    if (! info.isFile()) return QByteArray();
+
+    return QByteArray::number(info.size()) + ' ' + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+bool ResultCache::fetch(const QByteArray &hash, const QString &pdfFile, bool overwrite)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // The PDF is still the one we made
+    const QString key = pathKey(pdfFile);
+    const QByteArray state = fileState(pdfFile);
+    if (! state.isEmpty() and m_settings.value(key).toByteArray() == hash + ' ' + state) return true;
+
+    if (m_copyDir.isEmpty()) return false;
+    if (! overwrite and ! state.isEmpty()) return false;
+
+    const QString copy = m_copyDir + "/" + QString::fromLatin1(hash) + ".pdf";
+    if (! QFileInfo::exists(copy)) return false;
+
+    QFile::remove(pdfFile);
+    if (! QFile::copy(copy, pdfFile)) return false;
+
+    m_settings.setValue(key, hash + ' ' + fileState(pdfFile));
+    return true;
+}
+
+void ResultCache::store(const QByteArray &hash, const QString &pdfFile)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_settings.setValue(pathKey(pdfFile), hash + ' ' + fileState(pdfFile));
+
+    if (m_copyDir.isEmpty()) return;
+
+    // Copy to some temporary name first, a half copy must never be found
+    const QString copy = m_copyDir + "/" + QString::fromLatin1(hash) + ".pdf";
+    if (QFileInfo::exists(copy)) return;
+
+    const QString tmp = copy + ".tmp";
+    QFile::remove(tmp);
+    if (! QFile::copy(pdfFile, tmp) or ! QFile::rename(tmp, copy)) QFile::remove(tmp);
+}
@@ -0,0 +1,63 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QSettings>
+#include <QString>
+
+struct PageSetup;
+
+// Like make, but by content: A PDF is noted with the hash of its text and all
+// settings which change its look. When a PDF is asked for the same hash again
+// and is still there, untouched, there is nothing to do. With a cache directory
+// is a copy of each PDF kept there, so it can be fetched for any other name.
+// Thread safe, all jobs may share one cache
+class ResultCache
+{
+public:
+    // Without copyDir only existing PDFs are checked
+    explicit ResultCache(const QString &copyDir = QString());
+
+    // All about setup which goes into the PDF, to be given to hash()
+    static QByteArray setupKey(const PageSetup &setup);
+    // Of text file and key, empty if the text can't be read
+    static QByteArray hash(const QString &txtFile, const QByteArray &key);
+
+    // True when pdfFile is already the result of hash, or could be copied.
+    // Without overwrite an other existing pdfFile is never replaced by a copy
+    bool fetch(const QByteArray &hash, const QString &pdfFile, bool overwrite);
+    // Note pdfFile as result of hash, which was just created
+    void store(const QByteArray &hash, const QString &pdfFile);
+
+private:
+    static QString pathKey(const QString &pdfFile);
+    static QByteArray fileState(const QString &pdfFile);
+
+    QSettings m_settings;
+    QString   m_copyDir;
+    QMutex    m_mutex;
+};
+
+#endif
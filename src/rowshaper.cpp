@@ -0,0 +1,164 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "rowshaper.h"
+#include "pagesetup.h"
+
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QGlyphRun>
+#include <QTextLayout>
+#include <QTextOption>
+
+// Above are CJK and such, which are double width in a fixed pitch font anyway
+const int GlyphTableSize = 0x3000;
+const quint32 UnknownGlyph = 0xFFFFFFFF;
+const quint32 NeedsShaping = 0xFFFFFFFE;
+
+RowShaper::RowShaper(const QString &fontDesc, int dpi)
+    : m_fontDesc(fontDesc)
+    , m_dpi(dpi)
+    , m_font(independentFont(fontDesc, dpi))
+    , m_rawFont(QRawFont::fromFont(m_font))
+{
+    // Only a font which say it has fixed pitch may go the fast way, and each
+    // glyph is checked by glyphOf() too. Not all of them keep their promise
+    if (! QFontInfo(m_font).fixedPitch()) return;
+
+    const QChar x('X');
+    quint32 glyph = 0;
+    int numGlyphs = 1;
+    if (! m_rawFont.glyphIndexesForChars(&x, 1, &glyph, &numGlyphs) or ! glyph) return;
+
+    QPointF advance;
+    m_rawFont.advancesForGlyphIndexes(&glyph, &advance, 1);
+    m_advance = advance.x();
+    m_ascent = QFontMetricsF(m_font).ascent();
+    m_glyphs = QList<quint32>(GlyphTableSize, UnknownGlyph);
+}
+
+void RowShaper::shape(ShapedRow *row) const
+{
+    row->glyphIndexes.clear();
+    row->positions.clear();
+    row->isShaped = true;
+
+    if (row->text.isEmpty()) return;
+    if (m_advance > 0.0 and shapeFixedPitch(row)) return;
+
+    shapeLayout(row);
+}
+
+bool RowShaper::shapeFixedPitch(ShapedRow *row) const
+{
+    const qsizetype size = row->text.size();
+    const char16_t *text = reinterpret_cast<const char16_t *>(row->text.utf16());
+    row->glyphIndexes.resize(size);
+    row->positions.resize(size);
+
+    for (qsizetype i = 0; i < size; ++i) {
+        const quint32 glyph = text[i] < GlyphTableSize ? glyphOf(text[i]) : NeedsShaping;
+        if (glyph == NeedsShaping) {
+            row->glyphIndexes.clear();
+            row->positions.clear();
+            return false;
+        }
+        row->glyphIndexes[i] = glyph;
+        row->positions[i] = QPointF(i * m_advance, m_ascent);
+    }
+
+    return true;
+}
+
+quint32 RowShaper::glyphOf(char16_t c) const
+{
+    quint32 &glyph = m_glyphs[c];
+    if (glyph != UnknownGlyph) return glyph;
+
+    // Until we know better
+    glyph = NeedsShaping;
+
+    const QChar ch(c);
+    switch (ch.category()) {
+        case QChar::Mark_NonSpacing:
+        case QChar::Mark_SpacingCombining:
+        case QChar::Mark_Enclosing:
+        case QChar::Separator_Line:
+        case QChar::Separator_Paragraph:
+        case QChar::Other_Control:
+        case QChar::Other_Format:
+        case QChar::Other_Surrogate:
+        case QChar::Other_PrivateUse:
+        case QChar::Other_NotAssigned:
+            return glyph;
+        default:
+            break;
+    }
+
+    // Scripts without any joining, reordering or such
+    switch (ch.script()) {
+        case QChar::Script_Common:
+        case QChar::Script_Latin:
+        case QChar::Script_Greek:
+        case QChar::Script_Cyrillic:
+            break;
+        default:
+            return glyph;
+    }
+
+    // Missing in the font, the full shaping will find some fallback font
+    quint32 index = 0;
+    int numGlyphs = 1;
+    if (! m_rawFont.glyphIndexesForChars(&ch, 1, &index, &numGlyphs) or ! index) return glyph;
+
+    QPointF advance;
+    m_rawFont.advancesForGlyphIndexes(&index, &advance, 1);
+    if (qAbs(advance.x() - m_advance) > m_advance / 1000.0) return glyph;
+
+    glyph = index;
+    return glyph;
+}
+
+void RowShaper::shapeLayout(ShapedRow *row) const
+{
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+
+    QTextLayout layout(row->text, m_font);
+    layout.setTextOption(option);
+    layout.beginLayout();
+    layout.createLine(); // No width set, so endLayout() give it all
+    layout.endLayout();
+
+    const QList<QGlyphRun> runs = layout.glyphRuns();
+    for (const QGlyphRun &run : runs) {
+        if (run.rawFont() != m_rawFont) {
+            // The glyphs belong to some other font, which the drawing thread
+            // don't know. Let it do the job the simple way
+            row->glyphIndexes.clear();
+            row->positions.clear();
+            row->isShaped = false;
+            return;
+        }
+        row->glyphIndexes += run.glyphIndexes();
+        row->positions += run.positions();
+    }
+}
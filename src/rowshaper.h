@@ -0,0 +1,72 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef ROWSHAPER_H
+#define ROWSHAPER_H
+
+#include <QFont>
+#include <QList>
+#include <QPointF>
+#include <QRawFont>
+#include <QString>
+
+// One row of text and its glyphs. Only plain data, so it can be shaped by one
+// thread and drawn by another
+struct ShapedRow
+{
+    QString        text;
+    QList<quint32> glyphIndexes;
+    QList<QPointF> positions;       // Baseline included, relative to the row
+    bool           isShaped = false; // Not when some fallback font was needed
+};
+
+using ShapedPage = QList<ShapedRow>;
+
+// Turn rows into glyphs of the primary font. Fonts are not made to be shared
+// between threads, so each thread needs its own shaper.
+// With a fixed pitch font there is mostly nothing to shape, each char is one
+// glyph of the same advance. Only rows with something special, like combining
+// marks, other scripts or chars missing in the font, get the full shaping
+class RowShaper
+{
+public:
+    RowShaper(const QString &fontDesc, int dpi);
+
+    bool isFor(const QString &fontDesc, int dpi) const { return fontDesc == m_fontDesc and dpi == m_dpi; }
+
+    void shape(ShapedRow *row) const;
+
+private:
+    // Return false when the row needs the full shaping
+    bool shapeFixedPitch(ShapedRow *row) const;
+    void shapeLayout(ShapedRow *row) const;
+    quint32 glyphOf(char16_t c) const;
+
+    QString  m_fontDesc;
+    int      m_dpi;
+    QFont    m_font;
+    QRawFont m_rawFont;
+    qreal    m_advance = 0.0;   // Of each glyph, 0 when not fixed pitch
+    qreal    m_ascent = 0.0;
+    mutable QList<quint32> m_glyphs;  // Code point to glyph, filled when first needed
+};
+
+#endif
@@ -0,0 +1,137 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "server.h"
+
+#include <QDataStream>
+#include <QLocalSocket>
+
+// Bump when the request or reply change
+static const quint32 ProtocolMagic = 0x77327002;
+
+static QDataStream &operator<<(QDataStream &out, const ServerRequest &request)
+{
+    return out << ProtocolMagic << request.arguments << request.workDir << request.input;
+}
+
+static QDataStream &operator>>(QDataStream &in, ServerRequest &request)
+{
+    quint32 magic = 0;
+    in >> magic;
+    if (magic != ProtocolMagic) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return in;
+    }
+    return in >> request.arguments >> request.workDir >> request.input;
+}
+
+static QDataStream &operator<<(QDataStream &out, const ServerReply &reply)
+{
+    return out << ProtocolMagic << qint32(reply.exitCode) << reply.out << reply.err << reply.pdfFiles << reply.pdf;
+}
+
+static QDataStream &operator>>(QDataStream &in, ServerReply &reply)
+{
+    quint32 magic = 0;
+    qint32 exitCode = 1;
+    in >> magic;
+    if (magic != ProtocolMagic) {
+        in.setStatus(QDataStream::ReadCorruptData);
+        return in;
+    }
+    in >> exitCode >> reply.out >> reply.err >> reply.pdfFiles >> reply.pdf;
+    reply.exitCode = exitCode;
+    return in;
+}
+
+Server::Server(const Handler &handler)
+    : m_handler(handler)
+{
+    QObject::connect(&m_server, &QLocalServer::newConnection, [this]() {
+        while (QLocalSocket *socket = m_server.nextPendingConnection()) {
+            handleConnection(socket);
+        }
+    });
+}
+
+bool Server::listen(const QString &name)
+{
+    // A client may let us write any file the user can write, so nobody else
+    // must be able to connect
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    if (m_server.listen(name)) return true;
+    if (m_server.serverError() != QAbstractSocket::AddressInUseError) return false;
+
+    // Perhaps a crashed server left its socket file, but don't steal a living one
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(1000)) return false;
+
+    QLocalServer::removeServer(name);
+    return m_server.listen(name);
+}
+
+void Server::handleConnection(QLocalSocket *socket)
+{
+    QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    QObject::connect(socket, &QLocalSocket::readyRead, socket, [this, socket]() {
+        QDataStream in(socket);
+        in.setVersion(QDataStream::Qt_6_0);
+        ServerRequest request;
+        in.startTransaction();
+        in >> request;
+        if (! in.commitTransaction()) {
+            // Wait for the rest, or give up on garbage
+            if (in.status() != QDataStream::ReadPastEnd) socket->abort();
+            return;
+        }
+
+        QDataStream out(socket);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << m_handler(request);
+        socket->disconnectFromServer();
+    });
+}
+
+bool sendRequest(const QString &name, const ServerRequest &request, ServerReply *reply, QString *errorString)
+{
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    if (! socket.waitForConnected(3000)) {
+        *errorString = "Can't connect to server: " + socket.errorString();
+        return false;
+    }
+
+    QDataStream stream(&socket);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << request;
+
+    // The server answers not before the job is done, which may take a while
+    while (socket.waitForReadyRead(-1)) {
+        stream.startTransaction();
+        stream >> *reply;
+        if (stream.commitTransaction()) return true;
+        if (stream.status() != QDataStream::ReadPastEnd) break;
+    }
+
+    *errorString = "Bad or no reply from server: " + socket.errorString();
+    return false;
+}
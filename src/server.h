@@ -0,0 +1,78 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <QByteArray>
+#include <QLocalServer>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+class QLocalSocket;
+
+// A job for --serve is nothing else than a command line, run in the working
+// directory of the client. What would be read from stdin is sent along
+struct ServerRequest
+{
+    QStringList arguments;  // Without the program name
+    QString     workDir;
+    QByteArray  input;
+};
+
+// What the command would have printed and its exit code, plus the created PDFs
+struct ServerReply
+{
+    int         exitCode = 1;
+    QString     out;
+    QString     err;
+    QStringList pdfFiles;
+    QByteArray  pdf;        // When written to stdout by -
+};
+
+// Listen on a local socket, on Unix a Unix domain socket, and run each
+// request by the handler. Requests are handled one by one, each one can use
+// all threads it likes by --jobs
+class Server
+{
+public:
+    using Handler = std::function<ServerReply(const ServerRequest &)>;
+
+    explicit Server(const Handler &handler);
+
+    // Only the user who runs us may connect
+    bool listen(const QString &name);
+    QString serverName() const { return m_server.fullServerName(); }
+    QString errorString() const { return m_server.errorString(); }
+
+private:
+    void handleConnection(QLocalSocket *socket);
+
+    QLocalServer m_server;
+    Handler      m_handler;
+};
+
+// Send the request to a running server and wait for its reply
+bool sendRequest(const QString &name, const ServerRequest &request, ServerReply *reply, QString *errorString);
+
+#endif
@@ -0,0 +1,136 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "stats.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+static const char *const phaseNames[Stats::PhaseCount] = {
+    "parse", "resolve", "read", "layout", "print", "write"
+};
+
+static const char *const phaseLabels[Stats::PhaseCount] = {
+    "Parse Arguments  : ",
+    "Font Resolution  : ",
+    "Input Read       : ",
+    "Layout           : ",
+    "Print            : ",
+    "File Write       : "
+};
+
+// Only a program may count, a library must not replace malloc()
+static qint64 (*s_allocationCounter)() = nullptr;
+
+void Stats::enter(Phase phase)
+{
+    const Clock::time_point now = Clock::now();
+    if (m_phase >= 0) m_nsecs[m_phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last).count();
+    m_last = now;
+    m_phase = phase;
+}
+
+void Stats::stop()
+{
+    if (m_phase < 0) return;
+    m_nsecs[m_phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_last).count();
+    m_phase = -1;
+}
+
+void Stats::add(const Stats &other)
+{
+    for (int i = 0; i < PhaseCount; ++i) m_nsecs[i] += other.m_nsecs[i];
+    bytesRead += other.bytesRead;
+    linesRead += other.linesRead;
+    rows += other.rows;
+    pages += other.pages;
+    outputBytes += other.outputBytes;
+    files += other.files;
+}
+
+QString Stats::toText() const
+{
+    QString text;
+    qint64 total = 0;
+    for (int i = 0; i < PhaseCount; ++i) {
+        text += phaseLabels[i] + QString::number(m_nsecs[i] / 1000000.0, 'f', 2) + " ms\n";
+        total += m_nsecs[i];
+    }
+    text += "Total            : " + QString::number(total / 1000000.0, 'f', 2) + " ms\n"
+          + "Bytes Read       : " + QString::number(bytesRead) + '\n'
+          + "Lines Read       : " + QString::number(linesRead) + '\n'
+          + "Rows             : " + QString::number(rows) + '\n'
+          + "Pages            : " + QString::number(pages) + '\n'
+          + "Output Bytes     : " + QString::number(outputBytes) + '\n'
+          + "Files            : " + QString::number(files) + '\n'
+          + "Allocations      : " + ((allocations < 0) ? QString("not counted") : QString::number(allocations)) + '\n'
+          + "Peak RSS         : " + QString::number(peakRss()) + " KiB\n";
+
+    return text;
+}
+
+QByteArray Stats::toJson() const
+{
+    QJsonObject phases;
+    for (int i = 0; i < PhaseCount; ++i) phases[phaseNames[i]] = m_nsecs[i] / 1000000.0;
+
+    QJsonObject json;
+    json["phases_ms"] = phases;
+    json["bytes_read"] = bytesRead;
+    json["lines_read"] = linesRead;
+    json["rows"] = rows;
+    json["pages"] = pages;
+    json["output_bytes"] = outputBytes;
+    json["files"] = files;
+    json["allocations"] = allocations;
+    json["peak_rss_kb"] = peakRss();
+
+    return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+qint64 Stats::peakRss()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MACOS
+        return usage.ru_maxrss / 1024; // Bytes there
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
+qint64 Stats::allocationCount()
+{
+    return s_allocationCounter ? s_allocationCounter() : -1;
+}
+
+void Stats::setAllocationCounter(qint64 (*counter)())
+{
+    s_allocationCounter = counter;
+}
@@ -0,0 +1,80 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <chrono>
+
+// Where the time goes. There is always only one phase running, enter() stops
+// the current one and starts the next, which cost only one clock read.
+// Each thread needs its own Stats, add() them up when all is done, then the
+// times are the sum over all threads. The shaping done by the pool of the Qt
+// backend is not included
+class Stats
+{
+public:
+    enum Phase {
+        Parse,      // Including the start of the application
+        Resolve,
+        Read,
+        Layout,
+        Print,
+        Write,      // Finish the file, font embedding and alike
+        PhaseCount
+    };
+
+    void enter(Phase phase);
+    void stop();
+    void add(const Stats &other);
+
+    qint64 nsecs(Phase phase) const { return m_nsecs[phase]; }
+
+    QString toText() const;
+    QByteArray toJson() const;
+
+    qint64 bytesRead = 0;
+    qint64 linesRead = 0;
+    qint64 rows = 0;
+    qint64 pages = 0;
+    qint64 outputBytes = 0;     // Not known when written to a pipe
+    qint64 files = 0;
+    qint64 allocations = -1;    // In the conversion loops, -1 if not counted
+
+    // In KiB, of the whole process so far
+    static qint64 peakRss();
+    // Number of malloc() calls so far, -1 if not supported by this build
+    static qint64 allocationCount();
+    // Set by the program which counts them, see malloccounter.cpp
+    static void setAllocationCounter(qint64 (*counter)());
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    qint64            m_nsecs[PhaseCount] = {};
+    Clock::time_point m_last;
+    int               m_phase = -1;
+};
+
+#endif
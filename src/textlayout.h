@@ -0,0 +1,175 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+// The one and only rule how a line of text is split into rows. Everybody who
+// needs to know where a row ends has to ask here, otherwise pages would differ.
+// With a fixed pitch font we don't need any real layout, we simply count:
+// - Each character take one column, combining marks take none
+// - A tab advance to the next multiple of TabWidth
+// - A row is full at maxChar columns, there is no word wrapping
+
+#include <QByteArrayView>
+#include <QChar>
+#include <QString>
+#include <QStringView>
+
+namespace TextLayout {
+
+constexpr int TabWidth = 8;
+
+inline int columns(char32_t ucs)
+{
+    if (ucs < 0x300) return 1; // Fast path, nothing to combine below here
+
+    switch (QChar::category(ucs)) {
+        case QChar::Mark_NonSpacing:
+        case QChar::Mark_SpacingCombining:
+        case QChar::Mark_Enclosing:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+// Read the character at pos, advance pos behind it and return its columns
+inline int nextColumns(QStringView text, qsizetype &pos)
+{
+    const QChar c = text.at(pos++);
+    if (c.isHighSurrogate() and pos < text.size() and text.at(pos).isLowSurrogate()) {
+        return columns(QChar::surrogateToUcs4(c, text.at(pos++)));
+    }
+
+    return columns(c.unicode());
+}
+
+// Replace tabs by spaces. When there is no tab is line returned as it is,
+// otherwise is buffer filled and returned, so keep it around
+inline QStringView expandTabs(QStringView line, QString &buffer)
+{
+    if (! line.contains(u'\t')) return line;
+
+    buffer.resize(0);
+    int col = 0;
+    for (qsizetype i = 0; i < line.size(); ) {
+        if (line.at(i) == u'\t') {
+            const int gap = TabWidth - col % TabWidth;
+            buffer.resize(buffer.size() + gap, u' ');
+            col += gap;
+            ++i;
+            continue;
+        }
+        const qsizetype start = i;
+        col += nextColumns(line, i);
+        buffer.append(line.sliced(start, i - start));
+    }
+
+    return buffer;
+}
+
+// Call rowFunc(QStringView) for each row of line, an empty line is one empty row.
+// Tabs must be expanded before
+template<typename RowFunc>
+void wrapLine(QStringView line, int maxChar, RowFunc &&rowFunc)
+{
+    qsizetype start = 0;
+    int col = 0;
+    for (qsizetype i = 0; i < line.size(); ) {
+        const qsizetype pos = i;
+        const int width = nextColumns(line, i);
+        if (col + width > maxChar and pos > start) {
+            rowFunc(line.sliced(start, pos - start));
+            start = pos;
+            col = 0;
+        }
+        col += width;
+    }
+
+    rowFunc(line.sliced(start));
+}
+
+// Add a char of width columns to a row which has rowCol columns, and count the
+// rows it starts. Same as wrapLine() does, a tab counts as that many spaces
+inline void advanceRow(qint64 &rows, qint64 &rowCol, qint64 width, int maxChar)
+{
+    if (width == 0) return;
+
+    rows += (rowCol + width - 1) / maxChar;
+    rowCol = (rowCol + width - 1) % maxChar + 1;
+}
+
+// How many rows wrapLine() would give after expandTabs(), but without to do it
+inline qint64 rowCount(QStringView line, int maxChar)
+{
+    qint64 rows = 1;
+    qint64 col = 0;
+    qint64 rowCol = 0;
+    for (qsizetype i = 0; i < line.size(); ) {
+        qint64 width;
+        if (line.at(i) == u'\t') {
+            width = TabWidth - col % TabWidth;
+            ++i;
+        } else {
+            width = nextColumns(line, i);
+        }
+        col += width;
+        advanceRow(rows, rowCol, width, maxChar);
+    }
+
+    return rows;
+}
+
+// Same for a line of pure ASCII, each byte is one column
+inline qint64 rowCount(QByteArrayView line, int maxChar)
+{
+    // The usual case is simple math
+    if (! line.contains('\t')) return qMax<qint64>(1, (line.size() + maxChar - 1) / maxChar);
+
+    qint64 rows = 1;
+    qint64 col = 0;
+    qint64 rowCol = 0;
+    for (const char c : line) {
+        const qint64 width = (c == '\t') ? TabWidth - col % TabWidth : 1;
+        col += width;
+        advanceRow(rows, rowCol, width, maxChar);
+    }
+
+    return rows;
+}
+
+// Where row begins in line, which must have its tabs expanded. When line has
+// not that many rows, its size
+inline qsizetype rowStart(QStringView line, int maxChar, qint64 row)
+{
+    qsizetype start = line.size();
+    qint64 count = 0;
+    wrapLine(line, maxChar, [&](QStringView r) {
+        if (count++ == row) start = r.data() - line.data();
+    });
+
+    return start;
+}
+
+} // namespace TextLayout
+
+#endif
@@ -0,0 +1,203 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "textrenderer.h"
+#include "textlayout.h"
+
+#include <QFontMetricsF>
+#include <QPdfWriter>
+#include <QSemaphore>
+
+// Pages shaped by one task. Not too few to keep the overhead low, not too many
+// to keep the memory low
+const int SegmentPages = 8;
+
+struct TextRenderer::Segment
+{
+    QList<ShapedPage> pages;
+    QSemaphore        done;
+};
+
+TextRenderer::TextRenderer(QPdfWriter *writer, const QFont &font, int maxChar, int maxLines)
+    : m_writer(writer)
+    , m_font(font)
+    , m_maxChar(maxChar)
+    , m_maxLines(maxLines)
+{
+}
+
+TextRenderer::~TextRenderer()
+{
+    // Only when finish() was not called, don't leave running tasks behind
+    m_pool.waitForDone();
+}
+
+bool TextRenderer::begin()
+{
+    if (! m_painter.begin(m_writer)) {
+        m_errorString = "Can't paint on PDF";
+        return false;
+    }
+
+    m_painter.setFont(m_font);
+    // Must be the same metrics as used to calculate maxLines, or rows will not fit
+    const QFontMetricsF fm(m_font);
+    m_lineHeight = fm.height();
+    m_glyphRun.setRawFont(QRawFont::fromFont(m_font));
+    m_pageCount = 0;
+    m_page.reserve(m_maxLines);
+    m_segment = std::make_unique<Segment>();
+
+    if (m_threads > 1) {
+        m_pool.setMaxThreadCount(m_threads);
+    } else {
+        m_shaper = std::make_unique<RowShaper>(m_font.toString(), m_writer->resolution());
+    }
+
+    return true;
+}
+
+void TextRenderer::addLine(QStringView line)
+{
+    line = TextLayout::expandTabs(line, m_tabBuffer);
+    TextLayout::wrapLine(line, m_maxChar, [this](QStringView row) { addRow(row); });
+}
+
+void TextRenderer::addRow(QStringView row)
+{
+    if (m_stats) ++m_stats->rows;
+
+    ShapedRow shapedRow;
+    shapedRow.text = row.toString();
+    m_page.append(std::move(shapedRow));
+
+    if (m_page.size() == m_maxLines) finishPage();
+}
+
+void TextRenderer::finishPage()
+{
+    m_segment->pages.append(std::move(m_page));
+    m_page = ShapedPage();
+    m_page.reserve(m_maxLines);
+
+    if (m_segment->pages.size() == SegmentPages) {
+        if (m_stats) m_stats->enter(Stats::Print);
+        submitSegment();
+        if (m_stats) m_stats->enter(Stats::Layout);
+    }
+}
+
+void TextRenderer::submitSegment()
+{
+    std::unique_ptr<Segment> segment = std::move(m_segment);
+    m_segment = std::make_unique<Segment>();
+
+    if (segment->pages.isEmpty()) return;
+
+    if (! m_shaper) {
+        // Each thread has its own shaper, kept for the next task so its font
+        // and glyph cache are ready at once
+        Segment *s = segment.get();
+        const QString fontDesc = m_font.toString();
+        const int dpi = m_writer->resolution();
+        m_pool.start([s, fontDesc, dpi]() {
+            thread_local std::unique_ptr<RowShaper> shaper;
+            if (! shaper or ! shaper->isFor(fontDesc, dpi)) shaper = std::make_unique<RowShaper>(fontDesc, dpi);
+            for (ShapedPage &page : s->pages) {
+                for (ShapedRow &row : page) shaper->shape(&row);
+            }
+            s->done.release();
+        });
+        m_inProgress.push_back(std::move(segment));
+
+        // What is done already can be drawn now, so the first pages flow out
+        // as soon as possible and not only when the queue is full
+        while (! m_inProgress.empty() and m_inProgress.front()->done.available() > 0) {
+            drawSegment(m_inProgress.front().get());
+            m_inProgress.pop_front();
+        }
+
+        // Don't run away, the memory should stay low
+        while (m_inProgress.size() > size_t(m_threads) * 2) {
+            drawSegment(m_inProgress.front().get());
+            m_inProgress.pop_front();
+        }
+        return;
+    }
+
+    for (ShapedPage &page : segment->pages) {
+        for (ShapedRow &row : page) m_shaper->shape(&row);
+    }
+    segment->done.release();
+    drawSegment(segment.get());
+}
+
+void TextRenderer::drawSegment(Segment *segment)
+{
+    segment->done.acquire();
+    for (const ShapedPage &page : std::as_const(segment->pages)) {
+        drawPage(page);
+    }
+}
+
+void TextRenderer::drawPage(const ShapedPage &page)
+{
+    // The first page is already there by begin()
+    if (m_pageCount > 0) m_writer->newPage();
+    ++m_pageCount;
+
+    for (int i = 0; i < page.size(); ++i) {
+        const ShapedRow &row = page.at(i);
+        const QPointF origin(0.0, i * m_lineHeight);
+
+        if (row.isShaped) {
+            // Empty rows only need to be counted
+            if (row.glyphIndexes.isEmpty()) continue;
+            m_glyphRun.setGlyphIndexes(row.glyphIndexes);
+            m_glyphRun.setPositions(row.positions);
+            m_painter.drawGlyphRun(origin, m_glyphRun);
+        } else {
+            m_painter.drawText(QRectF(origin, QSizeF(m_writer->width(), m_lineHeight))
+                             , Qt::AlignLeft | Qt::AlignTop | Qt::TextSingleLine, row.text);
+        }
+    }
+}
+
+bool TextRenderer::finish()
+{
+    if (! m_page.isEmpty()) finishPage();
+    if (m_stats) m_stats->enter(Stats::Print);
+    submitSegment();
+
+    while (! m_inProgress.empty()) {
+        drawSegment(m_inProgress.front().get());
+        m_inProgress.pop_front();
+    }
+
+    m_shaper.reset();
+    if (m_stats) m_stats->enter(Stats::Write);
+    if (! m_painter.end()) {
+        m_errorString = "Failed to write PDF";
+        return false;
+    }
+
+    return true;
+}
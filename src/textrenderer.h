@@ -0,0 +1,89 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include <QFont>
+#include <QGlyphRun>
+#include <QPainter>
+#include <QRawFont>
+#include <QString>
+#include <QStringView>
+#include <QThreadPool>
+
+#include <deque>
+#include <memory>
+
+#include "renderer.h"
+#include "rowshaper.h"
+
+class QPdfWriter;
+
+// Draw the text line by line straight onto the PDF. No document is build,
+// so the memory use stay flat no matter how big the input is.
+// Each line is wrapped after maxChar columns, after maxLines rows a new page
+// is started, see TextLayout.
+// Because we know where each page start without any layout, we can hand the
+// expensive shaping of the rows to more threads. They work on segments of some
+// pages while we draw the finished ones in the right order to our one writer
+class TextRenderer : public Renderer
+{
+public:
+    TextRenderer(QPdfWriter *writer, const QFont &font, int maxChar, int maxLines);
+    ~TextRenderer() override;
+
+    void setThreads(int threads) { m_threads = qMax(1, threads); }
+
+    bool begin() override;
+    void addLine(QStringView line) override;
+    bool finish() override;
+
+    int pageCount() const override { return qMax(1, m_pageCount); }
+
+private:
+    struct Segment;
+
+    void addRow(QStringView row);
+    void finishPage();
+    void submitSegment();
+    void drawSegment(Segment *segment);
+    void drawPage(const ShapedPage &page);
+
+    QPdfWriter *m_writer;
+    QFont       m_font;
+    QPainter    m_painter;
+    QString     m_tabBuffer;
+    int         m_maxChar;
+    int         m_maxLines;
+    int         m_threads = 1;
+    int         m_pageCount = 0;
+    qreal       m_lineHeight = 0.0;
+    QGlyphRun   m_glyphRun;
+
+    ShapedPage  m_page;                                 // Currently filled
+    std::unique_ptr<Segment>             m_segment;     // Currently filled
+    std::deque<std::unique_ptr<Segment>> m_inProgress;  // Shaped by the pool
+    std::unique_ptr<RowShaper>           m_shaper;      // When no pool is used
+    QThreadPool m_pool;
+};
+
+#endif
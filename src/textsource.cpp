@@ -0,0 +1,406 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "textsource.h"
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QtAlgorithms>
+
+#include <cstring>
+#include <deque>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const qsizetype BufferChunk = 64 * 1024;
+// The read ahead is bound to this, so the memory use is too
+const qsizetype ReadAheadChunk = 256 * 1024;
+const size_t    ReadAheadDepth = 16;
+
+// Return the position of the next '\n' or end. All passed bytes are or'ed into
+// highBits, so we know afterwards if there was any non ASCII char
+const char *scanLine(const char *p, const char *end, uint &highBits)
+{
+#if defined(__SSE2__)
+    // 16 bytes at once. Without SSE2 (not x86) we hope for the compiler
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const uint found = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        const uint high = _mm_movemask_epi8(chunk);
+        if (found) {
+            const uint n = qCountTrailingZeroBits(found);
+            highBits |= high & ((1u << n) - 1);
+            return p + n;
+        }
+        highBits |= high;
+        p += 16;
+    }
+#endif
+    for ( ; p < end; ++p) {
+        if (*p == '\n') break;
+        highBits |= uchar(*p) & 0x80;
+    }
+
+    return p;
+}
+
+} // namespace
+
+struct TextSource::ReadAhead
+{
+    QMutex                 mutex;
+    QWaitCondition         changed;
+    std::deque<QByteArray> chunks;  // An empty one is the end of input
+    bool                   stop = false;
+    bool                   done = false;
+    bool                   failed = false;  // The end came by an error
+    int                    cancel[2] = {-1, -1};    // Pipe to wake the thread from poll()
+    std::thread            thread;
+};
+
+TextSource::TextSource()
+    : m_decoder(QStringConverter::Utf8, QStringConverter::Flag::Stateless)
+{
+}
+
+TextSource::~TextSource()
+{
+    close();
+}
+
+bool TextSource::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (! m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) return false;
+
+    return start();
+}
+
+bool TextSource::openStdin()
+{
+    close();
+    if (! m_file.open(0, QIODevice::ReadOnly | QIODevice::Unbuffered)) return false;
+
+    return start();
+}
+
+// Already all in memory, nothing to read
+bool TextSource::openData(const QByteArray &data)
+{
+    close();
+    m_buffer = data;
+    m_data = m_buffer.constData();
+    m_end = m_buffer.size();
+    m_atEof = true;
+    skipBom();
+
+    return true;
+}
+
+// Like a pipe, but the caller feed us
+bool TextSource::openPull(const PullFunc &pull)
+{
+    close();
+    m_pull = pull;
+    fillBuffer();
+    skipBom();
+
+    return true;
+}
+
+bool TextSource::seek(qint64 offset)
+{
+    if (! m_map or offset < 0 or offset > m_end) return false;
+    // Right behind a newline, or the BOM
+    if (offset > 0 and m_data[offset - 1] != '\n' and (offset != 3 or memcmp(m_data, "\xEF\xBB\xBF", 3))) return false;
+
+    m_pos = m_scanPos = offset;
+    m_bytesRead = offset;
+    m_highBits = 0;
+
+    return true;
+}
+
+void TextSource::close()
+{
+    stopReadAhead();
+    if (m_map) m_file.unmap(m_map);
+    m_file.close();
+    m_pull = nullptr;
+    m_map = nullptr;
+    m_buffer.clear();
+    m_data = nullptr;
+    m_pos = 0;
+    m_scanPos = 0;
+    m_end = 0;
+    m_atEof = false;
+    m_readError = false;
+    m_highBits = 0;
+    m_bytesRead = 0;
+    m_linesRead = 0;
+}
+
+bool TextSource::start()
+{
+    // Pipes, devices and empty files can't be mapped, they are read piece by piece
+    const qint64 size = m_file.size();
+    if (! m_file.isSequential() and size > 0) {
+        m_map = m_file.map(0, size);
+    }
+
+    if (m_map) {
+#ifdef Q_OS_UNIX
+        madvise(m_map, size, MADV_SEQUENTIAL);
+#endif
+        m_data = reinterpret_cast<const char *>(m_map);
+        m_end = size;
+        m_atEof = true;
+    } else {
+#ifdef Q_OS_UNIX
+        if (m_file.isSequential()) startReadAhead();
+#endif
+        fillBuffer();
+    }
+
+    skipBom();
+
+    return true;
+}
+
+void TextSource::skipBom()
+{
+    // A pipe may give only a byte or two at first, but we need all three
+    while (m_end < 3 and fillBuffer()) {}
+
+    if (m_end >= 3 and ! memcmp(m_data, "\xEF\xBB\xBF", 3)) {
+        m_pos = m_scanPos = 3;
+        m_bytesRead = 3;
+    }
+}
+
+bool TextSource::fillBuffer()
+{
+    if (m_atEof) return false;
+
+    // Drop what is done, keep the begun line
+    if (m_pos > 0) {
+        const qsizetype keep = m_end - m_pos;
+        memmove(m_buffer.data(), m_buffer.constData() + m_pos, keep);
+        m_scanPos -= m_pos;
+        m_end = keep;
+        m_pos = 0;
+    }
+
+    if (m_readAhead) return takeReadAhead();
+
+    // Very long line? No problem, but we need more space
+    if (m_buffer.size() - m_end < BufferChunk / 2) {
+        m_buffer.resize(qMax(m_buffer.size() * 2, BufferChunk));
+    }
+
+    // Take what is there, don't wait until the buffer is full. A slow writer
+    // on the other end of the pipe should not slow us down even more
+    qint64 got;
+    if (m_pull) {
+        got = m_pull(m_buffer.data() + m_end, m_buffer.size() - m_end);
+    } else {
+#ifdef Q_OS_UNIX
+        do {
+            got = ::read(m_file.handle(), m_buffer.data() + m_end, m_buffer.size() - m_end);
+        } while (got < 0 and errno == EINTR);
+#else
+        got = m_file.read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+#endif
+    }
+
+    m_data = m_buffer.constData();
+    if (got <= 0) {
+        m_readError = got < 0;
+        m_atEof = true;
+        return false;
+    }
+
+    m_end += got;
+    return true;
+}
+
+void TextSource::startReadAhead()
+{
+#ifdef Q_OS_UNIX
+    // The thread never blocks in read(), it waits by poll() for data or the
+    // cancel pipe. So we can always join it, and it never touch the fd after
+    // close(), which may be reused by the next open() already
+    auto readAhead = std::make_shared<ReadAhead>();
+    if (pipe(readAhead->cancel) != 0) return;
+    const int fd = m_file.handle();
+    readAhead->thread = std::thread([readAhead, fd]() {
+        pollfd fds[2] = {{fd, POLLIN, 0}, {readAhead->cancel[0], POLLIN, 0}};
+        for (;;) {
+            QByteArray chunk(ReadAheadChunk, Qt::Uninitialized);
+            qint64 got = -1;
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) continue;
+                // Hopeless, end the input like a failed read() would do
+            } else if (fds[1].revents) {
+                return;
+            } else {
+                do {
+                    got = ::read(fd, chunk.data(), chunk.size());
+                } while (got < 0 and errno == EINTR);
+            }
+            chunk.truncate(qMax(qint64(0), got));
+
+            QMutexLocker locker(&readAhead->mutex);
+            while (readAhead->chunks.size() >= ReadAheadDepth and ! readAhead->stop) {
+                readAhead->changed.wait(&readAhead->mutex);
+            }
+            if (readAhead->stop) return;
+
+            readAhead->chunks.push_back(chunk);
+            readAhead->changed.wakeAll();
+            if (chunk.isEmpty()) {
+                readAhead->failed = got < 0;
+                readAhead->done = true;
+                return;
+            }
+        }
+    });
+    m_readAhead = readAhead;
+#endif
+}
+
+bool TextSource::takeReadAhead()
+{
+    QMutexLocker locker(&m_readAhead->mutex);
+    while (m_readAhead->chunks.empty()) m_readAhead->changed.wait(&m_readAhead->mutex);
+
+    // Take all there is, the reader can go on at once
+    qsizetype size = 0;
+    for (const QByteArray &chunk : m_readAhead->chunks) size += chunk.size();
+    if (m_buffer.size() - m_end < size) m_buffer.resize(m_end + size);
+
+    while (! m_readAhead->chunks.empty() and ! m_readAhead->chunks.front().isEmpty()) {
+        const QByteArray &chunk = m_readAhead->chunks.front();
+        memcpy(m_buffer.data() + m_end, chunk.constData(), chunk.size());
+        m_end += chunk.size();
+        m_readAhead->chunks.pop_front();
+    }
+    // Only the end is left, if any
+    m_atEof = ! m_readAhead->chunks.empty();
+    m_readError = m_readAhead->failed;
+    m_readAhead->changed.wakeAll();
+
+    m_data = m_buffer.constData();
+    return size > 0;
+}
+
+void TextSource::stopReadAhead()
+{
+    if (! m_readAhead) return;
+
+    QMutexLocker locker(&m_readAhead->mutex);
+    m_readAhead->stop = true;
+    m_readAhead->changed.wakeAll();
+    locker.unlock();
+
+#ifdef Q_OS_UNIX
+    // Don't wait for a writer which may never write again, the pipe wakes the
+    // thread in poll()
+    const char wake = 0;
+    while (::write(m_readAhead->cancel[1], &wake, 1) < 0 and errno == EINTR) {}
+    m_readAhead->thread.join();
+    ::close(m_readAhead->cancel[0]);
+    ::close(m_readAhead->cancel[1]);
+#endif
+    m_readAhead.reset();
+}
+
+bool TextSource::readRawLine(QByteArrayView *line)
+{
+    for (;;) {
+        const char *end = m_data + m_end;
+        const char *newline = scanLine(m_data + m_scanPos, end, m_highBits);
+
+        if (newline == end and ! m_atEof) {
+            // Incomplete line, fetch more and try again. Any pointer is now invalid
+            m_scanPos = m_end;
+            fillBuffer();
+            continue;
+        }
+
+        if (m_pos == m_end) return false;
+
+        const char *begin = m_data + m_pos;
+        qsizetype length = newline - begin;
+        const qsizetype next = newline - m_data + ((newline < end) ? 1 : 0);
+
+        m_bytesRead += next - m_pos;
+        ++m_linesRead;
+        m_pos = m_scanPos = next;
+        m_lineIsAscii = ! m_highBits;
+        m_highBits = 0;
+
+        if (length > 0 and begin[length - 1] == '\r') --length;
+        *line = QByteArrayView(begin, length);
+
+        return true;
+    }
+}
+
+bool TextSource::readLine(QStringView *line)
+{
+    QByteArrayView raw;
+    if (! readRawLine(&raw)) return false;
+
+    *line = decode(raw);
+    return true;
+}
+
+QStringView TextSource::decode(QByteArrayView raw)
+{
+    if (m_lineIsAscii) {
+        // Nothing to decode, a simple widen the compiler can vectorize
+        m_line.resize(raw.size());
+        QChar *out = m_line.data();
+        for (qsizetype i = 0; i < raw.size(); ++i) {
+            out[i] = QLatin1Char(raw[i]);
+        }
+    } else {
+        // Invalid sequences are replaced, like QTextStream does
+        m_line.resize(m_decoder.requiredSpace(raw.size()));
+        const QChar *end = m_decoder.appendToBuffer(m_line.data(), raw);
+        m_line.truncate(end - m_line.constData());
+    }
+
+    return QStringView(m_line);
+}
@@ -0,0 +1,107 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#ifndef TEXTSOURCE_H
+#define TEXTSOURCE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QString>
+#include <QStringDecoder>
+#include <QStringView>
+
+#include <functional>
+#include <memory>
+
+// Deliver the input line by line. A regular file is mapped into memory and the
+// lines are handed out as views into the mapping, only pipes and alike are read
+// into a buffer. The UTF-8 decoding is done into one reused buffer, pure ASCII
+// lines, which is the usual case, skip the decoder at all.
+// A pipe is drained by a thread of its own some chunks ahead, so a slow writer
+// and our work on the lines run side by side.
+// Like QTextStream::readLine() the line breaks "\n" and "\r\n" are removed and
+// a leading BOM is skipped
+class TextSource
+{
+public:
+    // Fill data with up to maxSize bytes and return how many, 0 at the end
+    // and -1 on error. Like read(), a short return is fine
+    using PullFunc = std::function<qint64(char *data, qint64 maxSize)>;
+
+    TextSource();
+    ~TextSource();
+
+    bool open(const QString &fileName);
+    bool openStdin();
+    bool openData(const QByteArray &data);
+    // Ask pull for more whenever the buffer runs dry, no thread involved
+    bool openPull(const PullFunc &pull);
+    void close();
+    // Continue at offset, which must be the begin of a line, else we refuse.
+    // Only possible on a mapped file, right after open()
+    bool seek(qint64 offset);
+
+    // The views are valid until the next call
+    bool readLine(QStringView *line);
+    bool readRawLine(QByteArrayView *line);
+    // Turn what readRawLine() gave into text, like readLine() does
+    QStringView decode(QByteArrayView raw);
+    // Of the last line, when true is any byte a char
+    bool lineIsAscii() const { return m_lineIsAscii; }
+
+    bool isMapped() const { return m_map; }
+    // The input ended by a read error, not at its end
+    bool hasReadError() const { return m_readError; }
+    qint64 bytesRead() const { return m_bytesRead; }
+    qint64 linesRead() const { return m_linesRead; }
+    QString errorString() const { return m_file.errorString(); }
+
+private:
+    struct ReadAhead;
+
+    bool start();
+    void skipBom();
+    bool fillBuffer();
+    void startReadAhead();
+    bool takeReadAhead();
+    void stopReadAhead();
+
+    QFile           m_file;
+    uchar          *m_map = nullptr;
+    QByteArray      m_buffer;       // Only used when not mapped, or the data itself
+    const char     *m_data = nullptr;
+    qsizetype       m_pos = 0;      // Start of next line
+    qsizetype       m_scanPos = 0;  // Already scanned for newline
+    qsizetype       m_end = 0;
+    bool            m_atEof = false;
+    bool            m_readError = false;
+    bool            m_lineIsAscii = true;
+    uint            m_highBits = 0;
+    qint64          m_bytesRead = 0;
+    qint64          m_linesRead = 0;
+    QString         m_line;
+    QStringDecoder  m_decoder;
+    PullFunc        m_pull;         // Instead of m_file when set
+    std::shared_ptr<ReadAhead> m_readAhead; // Only for pipes and alike
+};
+
+#endif
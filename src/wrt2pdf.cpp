@@ -0,0 +1,219 @@
+//
+//  wrt2pdf - Create a PDF out of a plain text file
+//
+//  Copyright (C) 2022, 2024 loh.tar@googlemail.com
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+//  MA 02110-1301, USA.
+
+
+#include "wrt2pdf.h"
+#include "converter.h"
+#include "pagesetup.h"
+#include "pdfrenderer.h"
+
+#include <QIODevice>
+#include <QThread>
+
+struct Wrt2Pdf::Private
+{
+    // Any change of the settings need a new resolve()
+    void reset();
+    bool resolve();
+    bool run(const ConvertJob &job);
+
+    PageSetup                  wanted;
+    std::unique_ptr<PageSetup> setup;       // Converter keep a reference, so it must not move
+    std::unique_ptr<Converter> converter;
+    int                        threads = 1;
+    QString                    errorString;
+};
+
+Wrt2Pdf::Wrt2Pdf()
+    : d(std::make_unique<Private>())
+{
+}
+
+Wrt2Pdf::~Wrt2Pdf() = default;
+
+bool Wrt2Pdf::setFont(const QString &desc)
+{
+    if (! d->wanted.parseFont(desc)) {
+        d->errorString = "Too much set: " + desc;
+        return false;
+    }
+
+    d->reset();
+    return true;
+}
+
+bool Wrt2Pdf::setPageSize(const QString &key)
+{
+    if (! d->wanted.parsePageSize(key)) {
+        d->errorString = "Key not found: " + key;
+        return false;
+    }
+
+    d->reset();
+    return true;
+}
+
+void Wrt2Pdf::setLandscape(bool landscape)
+{
+    d->wanted.pageOrientation = landscape ? QPageLayout::Landscape : QPageLayout::Portrait;
+    d->reset();
+}
+
+bool Wrt2Pdf::setMargins(const QString &list)
+{
+    if (! d->wanted.parseMargins(list)) {
+        d->errorString = "Bad margin value: " + list;
+        return false;
+    }
+
+    d->reset();
+    return true;
+}
+
+bool Wrt2Pdf::setBackend(const QString &name)
+{
+    if (! d->wanted.parseBackend(name)) {
+        d->errorString = "Unknown backend: " + name;
+        return false;
+    }
+
+    d->reset();
+    return true;
+}
+
+bool Wrt2Pdf::setCompression(int level)
+{
+    if (level < 0 or level > 9) {
+        d->errorString = QString("Bad compression level: %1").arg(level);
+        return false;
+    }
+
+    d->wanted.compression = level;
+    d->reset();
+    return true;
+}
+
+void Wrt2Pdf::setObjectStreams(bool enable)
+{
+    d->wanted.objectStreams = enable;
+    d->reset();
+}
+
+void Wrt2Pdf::setThreads(int threads)
+{
+    d->threads = (threads > 0) ? threads : QThread::idealThreadCount();
+    if (d->converter) d->converter->setThreads(d->threads);
+}
+
+void Wrt2Pdf::Private::reset()
+{
+    converter.reset();
+    setup.reset();
+}
+
+bool Wrt2Pdf::resolve()
+{
+    return d->resolve();
+}
+
+bool Wrt2Pdf::Private::resolve()
+{
+    if (converter) return true;
+
+    // The costly part, fontconfig is asked for the font
+    if (! setup) {
+        setup = std::make_unique<PageSetup>(wanted);
+        setup->resolve();
+    }
+
+    // Same checks as the command line does, or we would make a broken PDF
+    if (setup->maxChar < 1 or setup->maxLines < 1) {
+        errorString = "No print area";
+        return false;
+    }
+    if (setup->backend == PageSetup::NativeBackend and ! PdfRenderer::supports(setup->font)) {
+        errorString = "Font not supported by native backend, only TrueType: " + setup->usedFamily;
+        return false;
+    }
+
+    converter = std::make_unique<Converter>(*setup);
+    converter->setThreads(threads);
+    return true;
+}
+
+int Wrt2Pdf::maxChar() const
+{
+    return d->setup ? d->setup->maxChar : 0;
+}
+
+int Wrt2Pdf::maxLines() const
+{
+    return d->setup ? d->setup->maxLines : 0;
+}
+
+bool Wrt2Pdf::convert(QByteArrayView text, QIODevice *sink, const QString &title)
+{
+    // No copy, the data is only read while we are here
+    const QByteArray data = QByteArray::fromRawData(text.data(), text.size());
+    ConvertJob job;
+    job.input = &data;
+    job.output = sink;
+    job.title = title;
+
+    return d->run(job);
+}
+
+bool Wrt2Pdf::convert(const PullFunc &pull, QIODevice *sink, const QString &title)
+{
+    ConvertJob job;
+    job.pull = pull;
+    job.output = sink;
+    job.title = title;
+
+    return d->run(job);
+}
+
+bool Wrt2Pdf::convert(const QString &txtFile, const QString &pdfFile)
+{
+    ConvertJob job;
+    job.txtFile = txtFile;
+    job.pdfFile = pdfFile;
+
+    return d->run(job);
+}
+
+bool Wrt2Pdf::Private::run(const ConvertJob &job)
+{
+    if (job.output and ! job.output->isWritable()) {
+        errorString = "The sink is not open for writing";
+        return false;
+    }
+
+    if (! resolve()) return false;
+    if (converter->convert(job)) return true;
+
+    errorString = converter->errorString();
+    return false;
+}
+
+QString Wrt2Pdf::errorString() const
+{
+    return d->errorString;
+}